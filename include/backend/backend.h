@@ -8,4 +8,5 @@
 #include "lang/workspace.h"
 
 bool backend_output(struct workspace *wk);
+bool backend_up_to_date(struct workspace *wk);
 #endif
@@ -8,12 +8,20 @@
 
 #include "lang/workspace.h"
 
+/* compile_commands.json, written alongside build.ninja */
+struct ninja_compdb {
+	FILE *out;
+	uint32_t len;
+};
+
 struct write_tgt_ctx {
 	FILE *out;
 	const struct project *proj;
+	struct ninja_compdb *compdb;
 	bool wrote_default;
 };
 
 bool ninja_write_all(struct workspace *wk);
+bool ninja_up_to_date(struct workspace *wk);
 int ninja_run(struct workspace *wk, obj args, const char *chdir, const char *capture);
 #endif
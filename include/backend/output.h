@@ -10,7 +10,8 @@
 
 struct output_path {
 	const char *private_dir, *summary, *tests, *install,
-		   *compiler_check_cache, *option_info;
+		   *compiler_check_cache, *option_info, *test_durations,
+		   *regenerate_deps, *ast_cache;
 };
 
 extern const struct output_path output_path;
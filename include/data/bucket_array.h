@@ -35,5 +35,4 @@ void bucket_array_clear(struct bucket_array *ba);
 void bucket_array_save(const struct bucket_array *ba, struct bucket_array_save *save);
 void bucket_array_restore(struct bucket_array *ba, const struct bucket_array_save *save);
 void bucket_array_destroy(struct bucket_array *ba);
-bool bucket_array_lookup_pointer(struct bucket_array *ba, const uint8_t *p, uint64_t *ret);
 #endif
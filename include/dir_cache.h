@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_DIR_CACHE_H
+#define MUON_DIR_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data/bucket_array.h"
+#include "data/darr.h"
+#include "data/hash.h"
+#include "lang/types.h"
+
+struct workspace;
+
+/*
+ * Answers existence checks for paths in the source tree from directory
+ * listings, so that each directory is read once instead of stat'ing every
+ * file passed to files() and friends.  Paths in the build directory are
+ * always checked on disk since setup writes there.
+ */
+struct dir_cache {
+	/* dir -> index into dirs_data */
+	struct hash dirs;
+	/* struct dir_cache_dir, see dir_cache.c */
+	struct darr dirs_data;
+	/* storage for the keys of all hashes */
+	struct bucket_array chrs;
+	struct {
+		uint32_t hits, dirs_read;
+	} stats;
+	bool init;
+};
+
+bool dir_cache_exists(struct workspace *wk, const char *path);
+bool dir_cache_file_exists(struct workspace *wk, const char *path);
+bool dir_cache_dir_exists(struct workspace *wk, const char *path);
+/*
+ * Record what was found at path in regenerate_queries, and add the
+ * directory containing it to regenerate_deps so that ninja notices when
+ * files are added or removed there.  setup -r then only reconfigures if
+ * the answer for path changed.  Only done for directories in the source
+ * tree.
+ */
+void dir_cache_add_regenerate_dep(struct workspace *wk, const char *path);
+/* what is at path now, to compare with the answers in regenerate_queries */
+obj dir_cache_path_type(struct workspace *wk, const char *path);
+/* forget everything, e.g. after running a command that may write anywhere */
+void dir_cache_clear(struct workspace *wk);
+void dir_cache_destroy(struct workspace *wk);
+#endif
@@ -12,4 +12,5 @@
 extern const bool have_libarchive;
 
 bool muon_archive_extract(const char *buf, size_t size, const char *dest_path);
+bool muon_archive_extract_file(const char *path, const char *dest_path);
 #endif
@@ -11,7 +11,26 @@
 
 extern const bool have_libcurl;
 
+/*
+ * A single transfer for muon_curl_fetch_many.  Data is handed to write as
+ * it arrives, in pieces of at most MUON_CURL_FETCH_BUF_SIZE bytes.
+ * Returning false from write aborts the transfer.
+ */
+struct muon_curl_fetch_req {
+	const char *url;
+	bool (*write)(void *ctx, const uint8_t *buf, uint64_t len);
+	void *ctx;
+	bool ok;
+};
+
+#define MUON_CURL_FETCH_BUF_SIZE (64 * 1024)
+
 void muon_curl_init(void);
 void muon_curl_deinit(void);
 bool muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len);
+/*
+ * Run all requests, at most max_parallel at a time.  Returns true if every
+ * request succeeded, req->ok records the result of each one.
+ */
+bool muon_curl_fetch_many(struct muon_curl_fetch_req *reqs, uint32_t len, uint32_t max_parallel);
 #endif
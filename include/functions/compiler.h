@@ -8,4 +8,6 @@
 #include "functions/common.h"
 
 extern const struct func_impl_name impl_tbl_compiler[];
+
+void compiler_check_cache_write_shared(struct workspace *wk);
 #endif
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_LANG_AST_CACHE_H
+#define MUON_LANG_AST_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "data/bucket_array.h"
+#include "data/hash.h"
+#include "lang/parser.h"
+
+struct workspace;
+struct source;
+
+/*
+ * Parsed asts, keyed by a hash of the source label and contents, so that
+ * evaluating the same source again skips lexing and parsing.  With save
+ * set, the asts of project files are also written to the private dir,
+ * where later setups of the same build dir find them.
+ */
+struct ast_cache {
+	/* key -> index into asts */
+	struct hash keys;
+	/* struct ast, these don't move since wk->ast points to them */
+	struct bucket_array asts;
+	/* total number of nodes in asts */
+	uint32_t nodes;
+	struct {
+		uint32_t hits, loaded, saved;
+	} stats;
+	/* set by setup -r, see cmd_setup */
+	bool save;
+	bool init, dir_created;
+};
+
+enum ast_cache_flag {
+	/* look in the private dir, and save there if enabled */
+	ast_cache_flag_persist = 1 << 0,
+};
+
+/*
+ * Sets *res to the ast of src, parsing it only if it is not cached.  If
+ * the ast is not kept in the cache *res is tmp, which the caller must
+ * destroy with ast_destroy either way.
+ */
+bool ast_cache_parse(struct workspace *wk, struct source *src, enum parse_mode mode, enum ast_cache_flag flags,
+	struct ast *tmp, struct ast **res);
+void ast_cache_destroy(struct workspace *wk);
+#endif
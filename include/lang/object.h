@@ -188,6 +188,7 @@ enum module {
 
 enum str_flags {
 	str_flag_big = 1 << 0,
+	str_flag_interned = 1 << 1, // immutable, unique in wk->interned_strs
 };
 
 struct str {
@@ -211,12 +212,18 @@ struct obj_module {
 	bool found, has_impl;
 };
 
+enum obj_array_flags {
+	obj_array_flag_big = 1 << 0,
+};
+
 struct obj_array {
-	obj val; // any
-	obj next; // obj_array
-	obj tail; // obj_array
-	uint32_t len;
-	bool have_next;
+	obj *e; // any
+	uint32_t len, cap;
+	enum obj_array_flags flags;
+};
+
+enum obj_dict_flags {
+	obj_dict_flag_hashed = 1 << 0,
 };
 
 struct obj_dict {
@@ -225,9 +232,17 @@ struct obj_dict {
 	obj next; // obj_array
 	obj tail; // obj_array
 	uint32_t len;
+	uint32_t hash; // index into wk->dict_hashes
+	enum obj_dict_flags flags;
 	bool have_next;
 };
 
+struct obj_dict_hash {
+	struct darr slots;
+	uint32_t len;
+	obj dict; // the dict this indexes
+};
+
 enum build_tgt_flags {
 	build_tgt_flag_export_dynamic = 1 << 0,
 	build_tgt_flag_pic = 1 << 1,
@@ -509,8 +524,8 @@ struct obj_source_configuration {
 /* end of object structs */
 
 struct obj_clear_mark {
-	uint32_t obji;
-	struct bucket_array_save objs, chrs;
+	uint32_t obji, dict_hashes;
+	struct bucket_array_save objs, chrs, array_elems;
 	struct bucket_array_save obj_aos[obj_type_count - _obj_aos_start];
 };
 
@@ -612,6 +627,7 @@ void obj_dict_merge(struct workspace *wk, obj dict, obj dict2, obj *res);
 void obj_dict_merge_nodup(struct workspace *wk, obj dict, obj dict2);
 void obj_dict_seti(struct workspace *wk, obj dict, uint32_t key, obj val);
 bool obj_dict_geti(struct workspace *wk, obj dict, uint32_t key, obj *val);
+void obj_dict_hashes_destroy(struct workspace *wk, uint32_t start);
 
 bool obj_iterable_foreach(struct workspace *wk, obj dict_or_array, void *ctx, obj_dict_iterator cb);
 #endif
@@ -88,18 +88,39 @@ enum {
 	node_visited = 1 << 4, // for analyzer
 };
 
+/*
+ * Only the fields the interpreter reads are kept here, the rest live in
+ * side tables of struct ast indexed by node id, see get_node_loc() and
+ * get_node_comments().
+ */
 struct node {
-	enum node_type type;
-	uint32_t line, col;
-	uint32_t subtype;
 	union token_data dat;
 	uint32_t l, r, c, d;
-	struct { uint32_t start, len; } comments;
+	uint32_t subtype;
+	enum node_type type;
+	/* builtin_run's cached lookup of this function name, see
+	 * func_lookup_cached() */
+	uint16_t fcache_key, fcache_idx;
 	uint8_t chflg;
 };
 
+struct node_loc {
+	uint32_t line, col;
+};
+
+/* a range of ast->comments */
+struct node_comments {
+	uint32_t start, len;
+};
+
 struct ast {
-	struct darr nodes, comments;
+	/* struct node */
+	struct darr nodes;
+	/* struct node_loc, one per node */
+	struct darr locs;
+	/* const char *, and struct node_comments one per node, only with
+	 * pm_keep_formatting */
+	struct darr comments, node_comments;
 	uint32_t root;
 };
 
@@ -113,6 +134,13 @@ bool parser_parse(struct workspace *wk, struct ast *ast, struct source_data *sda
 	enum parse_mode mode);
 void print_ast(struct ast *ast);
 struct node *get_node(struct ast *ast, uint32_t i);
+struct node_loc *get_node_loc(struct ast *ast, uint32_t i);
+struct node_comments *get_node_comments(struct ast *ast, uint32_t i);
+/*
+ * Set l of literal and id nodes to their value object or symbol id.  Done
+ * while parsing, and when an ast is loaded from the ast cache.
+ */
+void node_init_value(struct workspace *wk, struct node *n);
 const char *node_to_s(struct node *n);
 const char *node_type_to_s(enum node_type t);
 void ast_destroy(struct ast *ast);
@@ -10,6 +10,7 @@
 
 #include "lang/object.h"
 
+struct hash;
 struct workspace;
 
 #define WKSTR(cstring) (struct str){ .s = cstring, .len = strlen(cstring) }
@@ -60,16 +61,20 @@ bool str_has_null(const struct str *ss);
 const char *get_cstr(struct workspace *wk, obj s);
 obj make_str(struct workspace *wk, const char *str);
 obj make_strn(struct workspace *wk, const char *str, uint32_t n);
+obj make_str_interned(struct workspace *wk, const char *str);
+obj make_strn_interned(struct workspace *wk, const char *str, uint32_t n);
 obj make_strf(struct workspace *wk, const char *fmt, ...)
 MUON_ATTR_FORMAT(printf, 2, 3);
 
-void str_app(struct workspace *wk, obj s, const char *str);
-void str_appf(struct workspace *wk, obj s, const char *fmt, ...)
+void str_app(struct workspace *wk, obj *s, const char *str);
+void str_appf(struct workspace *wk, obj *s, const char *fmt, ...)
 MUON_ATTR_FORMAT(printf, 3, 4);
-void str_appn(struct workspace *wk, obj s, const char *str, uint32_t n);
+void str_appn(struct workspace *wk, obj *s, const char *str, uint32_t n);
 
 obj str_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val);
 
+uint64_t str_hash(const struct str *ss);
+void str_intern_table_init(struct hash *h);
 bool str_eql(const struct str *ss1, const struct str *ss2);
 bool str_startswith(const struct str *ss, const struct str *pre);
 bool str_endswith(const struct str *ss, const struct str *suf);
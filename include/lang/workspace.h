@@ -10,13 +10,16 @@
 #include "data/bucket_array.h"
 #include "data/darr.h"
 #include "data/hash.h"
+#include "dir_cache.h"
+#include "lang/ast_cache.h"
 #include "lang/eval.h"
 #include "lang/object.h"
 #include "lang/parser.h"
 #include "lang/string.h"
 
 struct project {
-	struct hash scope;
+	/* variables, indexed by symbol id, see scope_get */
+	struct darr scope;
 
 	obj source_root, build_root, cwd, build_dir, subproject_name;
 	obj opts, compilers, targets, tests, test_setups, summary;
@@ -62,6 +65,8 @@ struct workspace {
 	 * ----------------- */
 	/* obj_array that tracks files for build regeneration */
 	obj regenerate_deps;
+	/* obj_dict of paths checked by the fs module -> what was found there */
+	obj regenerate_queries;
 	/* TODO host machine dict */
 	obj host_machine;
 	/* TODO binaries dict */
@@ -82,18 +87,36 @@ struct workspace {
 	obj global_opts;
 	/* dict[sha_512 -> [bool, any]] */
 	obj compiler_check_cache;
+	/* dict[compiler -> [path, [sha_256]]], see compiler_check_shared_load */
+	obj compiler_check_shared;
 	/* ----------------- */
 
+	/* max number of compiler checks run concurrently */
+	uint32_t compiler_check_jobs;
+
+	struct dir_cache dir_cache;
+	struct ast_cache ast_cache;
+
 	struct bucket_array chrs;
+	/* elements of small arrays */
+	struct bucket_array array_elems;
 	struct bucket_array objs;
 	struct bucket_array obj_aos[obj_type_count - _obj_aos_start];
+	/* hash indices for large dicts */
+	struct darr dict_hashes;
 
 	struct darr projects;
 	struct darr option_overrides;
 	struct darr source_data;
 
-	struct hash scope;
+	/* global variables, indexed by symbol id */
+	struct darr scope;
+	/* identifier -> symbol id, and symbol id -> identifier */
+	struct hash symbols;
+	struct darr symbol_names;
 	struct hash obj_hash;
+	/* str -> obj, see make_strn_interned */
+	struct hash interned_strs;
 
 	uint32_t loop_depth, impure_loop_depth;
 	enum loop_ctl loop_ctl;
@@ -127,7 +150,19 @@ struct workspace {
 #endif
 };
 
+uint32_t symbol_id(struct workspace *wk, const char *name);
+bool symbol_lookup(struct workspace *wk, const char *name, uint32_t *sym);
+const char *symbol_name(struct workspace *wk, uint32_t sym);
+
+bool scope_get_sym(struct darr *scope, uint32_t sym, obj *res);
+void scope_set_sym(struct darr *scope, uint32_t sym, obj val);
+void scope_unset_sym(struct darr *scope, uint32_t sym);
+bool scope_get(struct workspace *wk, struct darr *scope, const char *name, obj *res);
+void scope_set(struct workspace *wk, struct darr *scope, const char *name, obj val);
+void scope_unset(struct workspace *wk, struct darr *scope, const char *name);
+
 bool get_obj_id(struct workspace *wk, const char *name, obj *res, uint32_t proj_id);
+bool get_obj_id_sym(struct workspace *wk, uint32_t sym, obj *res, uint32_t proj_id);
 
 void workspace_init_bare(struct workspace *wk);
 void workspace_init(struct workspace *wk);
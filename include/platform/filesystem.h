@@ -19,6 +19,16 @@ struct source {
 	uint64_t len;
 };
 
+struct fs_find_cmd_stats {
+	uint64_t hits, misses, lookups_saved;
+};
+
+struct fs_mapping {
+	uint8_t *data;
+	uint64_t len;
+	bool mapped;
+};
+
 struct workspace;
 struct sbuf;
 
@@ -37,9 +47,26 @@ FILE *fs_fopen(const char *path, const char *mode);
 bool fs_fwrite(const void *ptr, size_t size, FILE *f);
 bool fs_fread(void *ptr, size_t size, FILE *f);
 bool fs_write(const char *path, const uint8_t *buf, uint64_t buf_len);
+bool fs_remove(const char *path);
+bool fs_rename(const char *old_path, const char *new_path);
+/* exclusive advisory lock, released by fs_unlock or fs_fclose */
+bool fs_lock(FILE *f);
+bool fs_unlock(FILE *f);
 bool fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd);
+/* platform specific PATH walk behind fs_find_cmd's cache */
+bool fs_find_cmd_uncached(struct workspace *wk, struct sbuf *buf, const char *cmd, uint32_t *lookups);
+const struct fs_find_cmd_stats *fs_find_cmd_cache_stats(void);
 bool fs_has_cmd(const char *cmd);
 void fs_source_destroy(struct source *src);
+/*
+ * Map the contents of f privately, so they may be modified in memory
+ * without affecting the file.  Files that can't be mapped, such as pipes,
+ * are read into a buffer instead.
+ */
+bool fs_map(FILE *f, struct fs_mapping *m);
+void fs_unmap(struct fs_mapping *m);
+void *fs_mmap_private(FILE *f, uint64_t len);
+void fs_munmap(void *addr, uint64_t len);
 void fs_source_dup(const struct source *src, struct source *dup);
 bool fs_redirect(const char *path, const char *mode, int fd, int *old_fd);
 bool fs_redirect_restore(int fd, int old_fd);
@@ -52,6 +79,7 @@ bool fs_ftell(FILE *file, uint64_t *res);
 const char *fs_user_home(void);
 bool fs_is_a_tty_from_fd(int fd);
 bool fs_is_a_tty(FILE *f);
+bool fs_touch(const char *path);
 bool fs_chmod(const char *path, uint32_t mode);
 bool fs_copy_metadata(const char *src, const char *dest);
 /* Windows only */
@@ -60,6 +88,23 @@ bool fs_has_extension(const char *path, const char *ext);
 typedef enum iteration_result ((*fs_dir_foreach_cb)(void *_ctx, const char *path));
 bool fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb);
 
+/*
+ * The type of a directory entry as reported by the listing.  Symlinks, and
+ * entries on file systems that don't report a type, are
+ * fs_dir_entry_type_unknown and need to be stat'd.
+ */
+enum fs_dir_entry_type {
+	fs_dir_entry_type_unknown,
+	fs_dir_entry_type_file,
+	fs_dir_entry_type_dir,
+	fs_dir_entry_type_other,
+};
+
+typedef enum iteration_result ((*fs_dir_foreach_typed_cb)(void *_ctx, const char *path, enum fs_dir_entry_type t));
+bool fs_dir_foreach_typed(const char *path, void *_ctx, fs_dir_foreach_typed_cb cb);
+/* returns false if path doesn't exist, follows symlinks */
+bool fs_entry_type(const char *path, enum fs_dir_entry_type *t);
+
 #ifndef S_ISGID
 #define S_ISGID 0
 #endif
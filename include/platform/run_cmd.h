@@ -69,6 +69,11 @@ uint32_t argstr_to_argv(const char *argstr, uint32_t argc, const char *prepend,
 bool run_cmd(struct run_cmd_ctx *ctx, const char *argstr, uint32_t argc, const char *envstr, uint32_t envc);
 bool run_cmd_argv(struct run_cmd_ctx *ctx, char *const *argv, const char *envstr, uint32_t envc);
 enum run_cmd_state run_cmd_collect(struct run_cmd_ctx *ctx);
+/*
+ * Block until one of the async commands in ctxs has output or exits, or
+ * until timeout_ms has passed.  Use run_cmd_collect to find out which.
+ */
+void run_cmd_wait(struct run_cmd_ctx *const *ctxs, uint32_t len, uint32_t timeout_ms);
 void run_cmd_ctx_destroy(struct run_cmd_ctx *ctx);
 bool run_cmd_kill(struct run_cmd_ctx *ctx, bool force);
 #endif
@@ -9,5 +9,27 @@
 #include <stdint.h>
 #include <stddef.h>
 
+/*
+ * Incremental hashing state.  Input may be fed in pieces of any size with
+ * sha_256_write, the result is the same as hashing it all at once.
+ */
+struct sha_256 {
+	uint32_t h[8];
+	uint8_t chunk[64];
+	size_t chunk_len;
+	uint64_t total_len;
+};
+
+void sha_256_init(struct sha_256 *sha);
+void sha_256_write(struct sha_256 *sha, const void *input, size_t len);
+void sha_256_close(struct sha_256 *sha, uint8_t hash[32]);
+
 void calc_sha_256(uint8_t hash[32], const void *input, size_t len);
+
+/*
+ * The block function is picked on first use, based on the instructions the
+ * cpu supports.  These are for benchmarks and tests.
+ */
+const char *sha_256_impl_name(void);
+void sha_256_force_scalar(void);
 #endif
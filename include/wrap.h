@@ -73,5 +73,11 @@ enum wrap_provides_key {
 void wrap_destroy(struct wrap *wrap);
 bool wrap_parse(const char *wrap_file, struct wrap *wrap);
 bool wrap_handle(const char *wrap_file, const char *subprojects, struct wrap *wrap, bool download);
+/*
+ * Download the archives of all given wraps into subprojects/packagecache
+ * concurrently, so that wrap_handle finds them there.  failed[i] is set for
+ * each wrap with an archive that could not be fetched.
+ */
+bool wrap_prefetch(const char *subprojects, const char *const wrap_files[], uint32_t len, bool failed[]);
 bool wrap_load_all_provides(struct workspace *wk, const char *subprojects);
 #endif
@@ -9,6 +9,14 @@
 #define __EXTENSIONS__
 #endif
 
+/* see platform/posix/filesystem.c */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#if defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE
+#endif
+
 #include "args.c"
 #include "backend/backend.c"
 #include "backend/common_args.c"
@@ -25,6 +33,7 @@
 #include "data/bucket_array.c"
 #include "data/darr.c"
 #include "data/hash.c"
+#include "dir_cache.c"
 #include "embedded.c"
 #include "error.c"
 #include "external/bestline_null.c"
@@ -77,6 +86,7 @@
 #include "guess.c"
 #include "install.c"
 #include "lang/analyze.c"
+#include "lang/ast_cache.c"
 #include "lang/eval.c"
 #include "lang/fmt.c"
 #include "lang/interpreter.c"
@@ -25,7 +25,7 @@ push_args(struct workspace *wk, obj arr, const struct args *args)
 {
 	uint32_t i;
 	for (i = 0; i < args->len; ++i) {
-		obj_array_push(wk, arr, make_str(wk, args->args[i]));
+		obj_array_push(wk, arr, make_str_interned(wk, args->args[i]));
 	}
 }
 
@@ -34,7 +34,7 @@ push_args_null_terminated(struct workspace *wk, obj arr, char *const *argv)
 {
 	char *const *arg;
 	for (arg = argv; *arg; ++arg) {
-		obj_array_push(wk, arr, make_str(wk, *arg));
+		obj_array_push(wk, arr, make_str_interned(wk, *arg));
 	}
 }
 
@@ -99,10 +99,10 @@ join_args_iter(struct workspace *wk, void *_ctx, obj val)
 		s = esc.buf;
 	}
 
-	str_app(wk, *ctx->obj, s);
+	str_app(wk, ctx->obj, s);
 
 	if (ctx->i < ctx->len - 1) {
-		str_app(wk, *ctx->obj, " ");
+		str_app(wk, ctx->obj, " ");
 	}
 
 	++ctx->i;
@@ -272,7 +272,7 @@ join_args_argstr_iter(struct workspace *wk, void *_ctx, obj v)
 
 	const struct str *s = get_str(wk, v);
 
-	str_appn(wk, ctx->str, s->s, s->len + 1);
+	str_appn(wk, &ctx->str, s->s, s->len + 1);
 
 	return ir_cont;
 }
@@ -302,8 +302,8 @@ env_to_envstr_dict_iter(struct workspace *wk, void *_ctx, obj key, obj val)
 	const struct str *k = get_str(wk, key),
 			 *v = get_str(wk, val);
 
-	str_appn(wk, ctx->str, k->s, k->len + 1);
-	str_appn(wk, ctx->str, v->s, v->len + 1);
+	str_appn(wk, &ctx->str, k->s, k->len + 1);
+	str_appn(wk, &ctx->str, v->s, v->len + 1);
 
 	return ir_cont;
 }
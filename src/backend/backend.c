@@ -67,3 +67,9 @@ backend_output(struct workspace *wk)
 	TracyCZoneAutoE;
 	return true;
 }
+
+bool
+backend_up_to_date(struct workspace *wk)
+{
+	return ninja_up_to_date(wk);
+}
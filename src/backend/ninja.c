@@ -5,6 +5,7 @@
 
 #include "compat.h"
 
+#include <inttypes.h>
 #include <string.h>
 
 #include "args.h"
@@ -14,6 +15,7 @@
 #include "backend/ninja/custom_target.h"
 #include "backend/ninja/rules.h"
 #include "backend/output.h"
+#include "dir_cache.h"
 #include "error.h"
 #include "external/samurai.h"
 #include "lang/serial.h"
@@ -23,7 +25,9 @@
 #include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
+#include "sha_256.h"
 #include "tracy.h"
+#include "version.h"
 
 struct check_tgt_ctx {
 	bool need_phony;
@@ -103,6 +107,7 @@ write_tgt_iter(struct workspace *wk, void *_ctx, obj tgt_id)
 
 struct write_build_ctx {
 	obj compiler_rule_arr;
+	struct ninja_compdb compdb;
 };
 
 static bool
@@ -133,14 +138,14 @@ ninja_write_build(struct workspace *wk, void *_ctx, FILE *out)
 			continue;
 		}
 
-		struct write_tgt_ctx ctx = { .out = out, .proj = proj };
+		struct write_tgt_ctx tgt_ctx = { .out = out, .proj = proj, .compdb = &ctx->compdb };
 
-		if (!obj_array_foreach(wk, proj->targets, &ctx, write_tgt_iter)) {
+		if (!obj_array_foreach(wk, proj->targets, &tgt_ctx, write_tgt_iter)) {
 			LOG_E("failed to write rules for project %s", get_cstr(wk, proj->cfg.name));
 			return false;
 		}
 
-		wrote_default |= ctx.wrote_default;
+		wrote_default |= tgt_ctx.wrote_default;
 	}
 
 	if (!wrote_default) {
@@ -236,39 +241,182 @@ ninja_write_option_info(struct workspace *wk, void *_ctx, FILE *out)
 	return serial_dump(wk, arr, out);
 }
 
+/*
+ * The regeneration command passes -r to setup, which uses the digests
+ * recorded here to skip reconfiguring entirely when none of the files
+ * build.ninja depends on have changed content, e.g. after a checkout that
+ * only touched their mtimes.  Any real change still reconfigures the whole
+ * project.
+ *
+ * The key includes the size and mtime of the muon binary so that a rebuilt
+ * muon with the same version string does not reuse stale output.
+ */
+static obj
+regenerate_deps_version(struct workspace *wk)
+{
+	obj ver = make_strf(wk, "%s-%s", muon_version.version, muon_version.vcs_tag);
+
+	SBUF(exe);
+	struct stat sb;
+	if (fs_find_cmd(wk, &exe, wk->argv0) && fs_stat(exe.buf, &sb)) {
+		str_appf(wk, &ver, "-%" PRIu64 "-%" PRIu64, (uint64_t)sb.st_size, (uint64_t)sb.st_mtime);
+	}
+
+	return ver;
+}
+
+static obj
+regenerate_dep_digest(struct workspace *wk, const char *path)
+{
+	/*
+	 * Directories are added by fs.exists() and friends.  What matters is
+	 * the answer for each path that was checked, which is compared
+	 * separately.
+	 */
+	struct source src;
+	if (!fs_file_exists(path) || !fs_read_entire_file(path, &src)) {
+		return make_str(wk, "");
+	}
+
+	uint8_t sha[32];
+	calc_sha_256(sha, src.src, src.len);
+	fs_source_destroy(&src);
+	return make_strn(wk, (const char *)sha, 32);
+}
+
+static enum iteration_result
+write_regenerate_deps_iter(struct workspace *wk, void *_ctx, obj v)
+{
+	obj digests = *(obj *)_ctx;
+	obj_dict_set(wk, digests, v, regenerate_dep_digest(wk, get_cstr(wk, v)));
+	return ir_cont;
+}
+
+static bool
+ninja_write_regenerate_deps(struct workspace *wk, void *_ctx, FILE *out)
+{
+	obj deduped, digests;
+	obj_array_dedup(wk, wk->regenerate_deps, &deduped);
+	make_obj(wk, &digests, obj_dict);
+	obj_array_foreach(wk, deduped, &digests, write_regenerate_deps_iter);
+
+	obj arr;
+	make_obj(wk, &arr, obj_array);
+	obj_array_push(wk, arr, regenerate_deps_version(wk));
+	obj_array_push(wk, arr, digests);
+	obj_array_push(wk, arr, wk->regenerate_queries);
+
+	return serial_dump(wk, arr, out);
+}
+
+static enum iteration_result
+regenerate_deps_unchanged_iter(struct workspace *wk, void *_ctx, obj k, obj v)
+{
+	if (!str_eql(get_str(wk, v), get_str(wk, regenerate_dep_digest(wk, get_cstr(wk, k))))) {
+		L("%s changed", get_cstr(wk, k));
+		return ir_err;
+	}
+
+	return ir_cont;
+}
+
+static enum iteration_result
+regenerate_queries_unchanged_iter(struct workspace *wk, void *_ctx, obj k, obj v)
+{
+	if (get_obj_type(wk, v) != obj_number
+	    || get_obj_number(wk, v) != get_obj_number(wk, dir_cache_path_type(wk, get_cstr(wk, k)))) {
+		L("%s changed", get_cstr(wk, k));
+		return ir_err;
+	}
+
+	return ir_cont;
+}
+
+static bool
+regenerate_deps_unchanged(struct workspace *wk)
+{
+	SBUF(path);
+	path_join(wk, &path, wk->build_root, "build.ninja");
+	if (!fs_file_exists(path.buf)) {
+		return false;
+	}
+
+	path_join(wk, &path, wk->muon_private, output_path.regenerate_deps);
+	if (!fs_file_exists(path.buf)) {
+		return false;
+	}
+
+	FILE *f;
+	obj arr;
+	bool loaded;
+	if (!(f = fs_fopen(path.buf, "rb"))) {
+		return false;
+	}
+	loaded = serial_load(wk, &arr, f);
+	if (!fs_fclose(f) || !loaded) {
+		return false;
+	}
+
+	obj version, digests, queries;
+	if (get_obj_type(wk, arr) != obj_array || get_obj_array(wk, arr)->len != 3) {
+		return false;
+	}
+	obj_array_index(wk, arr, 0, &version);
+	obj_array_index(wk, arr, 1, &digests);
+	obj_array_index(wk, arr, 2, &queries);
+
+	if (get_obj_type(wk, version) != obj_string || get_obj_type(wk, digests) != obj_dict
+	    || get_obj_type(wk, queries) != obj_dict
+	    || !str_eql(get_str(wk, version), get_str(wk, regenerate_deps_version(wk)))) {
+		return false;
+	}
+
+	return obj_dict_foreach(wk, digests, NULL, regenerate_deps_unchanged_iter)
+	       && obj_dict_foreach(wk, queries, NULL, regenerate_queries_unchanged_iter);
+}
+
+bool
+ninja_up_to_date(struct workspace *wk)
+{
+	if (!regenerate_deps_unchanged(wk)) {
+		return false;
+	}
+
+	/* ninja compares mtimes, so build.ninja must be newer than its deps */
+	SBUF(path);
+	path_join(wk, &path, wk->build_root, "build.ninja");
+	return fs_touch(path.buf);
+}
+
 bool
 ninja_write_all(struct workspace *wk)
 {
 	struct write_build_ctx ctx = { 0 };
 	make_obj(wk, &ctx.compiler_rule_arr, obj_array);
 
-	if (!(with_open(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build)
+	if (!(ctx.compdb.out = output_open(wk->build_root, "compile_commands.json"))) {
+		return false;
+	}
+	fputc('[', ctx.compdb.out);
+
+	bool ok = with_open(wk->build_root, "build.ninja", wk, &ctx, ninja_write_build);
+
+	fputs("\n]\n", ctx.compdb.out);
+	if (!fs_fclose(ctx.compdb.out)) {
+		return false;
+	}
+
+	if (!(ok
 	      && with_open(wk->muon_private, output_path.tests, wk, NULL, ninja_write_tests)
 	      && with_open(wk->muon_private, output_path.install, wk, NULL, ninja_write_install)
 	      && with_open(wk->muon_private, output_path.compiler_check_cache, wk, NULL, ninja_write_compiler_check_cache)
 	      && with_open(wk->muon_private, output_path.summary, wk, NULL, ninja_write_summary_file)
 	      && with_open(wk->muon_private, output_path.option_info, wk, NULL, ninja_write_option_info)
+	      && with_open(wk->muon_private, output_path.regenerate_deps, wk, NULL, ninja_write_regenerate_deps)
 	      )) {
 		return false;
 	}
 
-	{/* compile_commands.json */
-		TracyCZoneN(tctx_compdb, "output compile_commands.json", true);
-
-		obj compdb_args;
-		make_obj(wk, &compdb_args, obj_array);
-		obj_array_push(wk, compdb_args, make_str(wk, "-C"));
-		obj_array_push(wk, compdb_args, make_str(wk, wk->build_root));
-		obj_array_push(wk, compdb_args, make_str(wk, "-t"));
-		obj_array_push(wk, compdb_args, make_str(wk, "compdb"));
-		obj_array_extend_nodup(wk, compdb_args, ctx.compiler_rule_arr);
-		if (ninja_run(wk, compdb_args, wk->build_root, "compile_commands.json") != 0) {
-			LOG_E("error writing compile_commands.json");
-		}
-
-		TracyCZoneEnd(tctx_compdb);
-	}
-
 	return true;
 }
 
@@ -20,6 +20,7 @@
 
 struct write_tgt_iter_ctx {
 	FILE *out;
+	struct ninja_compdb *compdb;
 	const struct obj_build_target *tgt;
 	const struct project *proj;
 	struct build_dep args;
@@ -43,6 +44,77 @@ add_tgt_objects_iter(struct workspace *wk, void *_ctx, obj val)
 	return ir_cont;
 }
 
+static void
+compdb_write_json_str(FILE *out, const char *s)
+{
+	fputc('"', out);
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\') {
+			fprintf(out, "\\%c", *s);
+		} else if ((uint8_t)*s < 0x20) {
+			fprintf(out, "\\u%04x", *s);
+		} else {
+			fputc(*s, out);
+		}
+	}
+	fputc('"', out);
+}
+
+/*
+ * Writes the entry that `ninja -t compdb` would produce for this source,
+ * i.e. the compiler rule's command with ARGS, in, and out expanded.
+ */
+static void
+compdb_write_entry(struct workspace *wk, struct write_tgt_iter_ctx *ctx,
+	enum compiler_language lang, obj joined_args, const char *src_path, const char *dest_path)
+{
+	obj comp_id;
+	if (!obj_dict_geti(wk, ctx->proj->compilers, lang, &comp_id)) {
+		UNREACHABLE;
+	}
+	enum compiler_type t = get_obj_compiler(wk, comp_id)->type;
+
+	SBUF(cmd);
+	sbuf_pushs(wk, &cmd, get_cstr(wk, join_args_plain(wk, get_obj_compiler(wk, comp_id)->cmd_arr)));
+	sbuf_push(wk, &cmd, ' ');
+
+	/* ARGS is escaped for ninja, undo that */
+	const char *p;
+	for (p = get_cstr(wk, joined_args); *p; ++p) {
+		if (*p == '$' && p[1]) {
+			++p;
+		}
+		sbuf_push(wk, &cmd, *p);
+	}
+
+	obj args;
+	make_obj(wk, &args, obj_array);
+	if (compilers[t].deps) {
+		SBUF(dep_path);
+		sbuf_pushf(wk, &dep_path, "%s.d", dest_path);
+		push_args(wk, args, compilers[t].args.deps(dest_path, dep_path.buf));
+	}
+	push_args(wk, args, compilers[t].args.output(dest_path));
+	push_args(wk, args, compilers[t].args.compile_only());
+	obj_array_push(wk, args, make_str(wk, src_path));
+
+	sbuf_push(wk, &cmd, ' ');
+	sbuf_pushs(wk, &cmd, get_cstr(wk, join_args_shell(wk, args)));
+
+	FILE *out = ctx->compdb->out;
+	fputs(ctx->compdb->len ? ",\n" : "\n", out);
+	fputs("  {\n    \"directory\": ", out);
+	compdb_write_json_str(out, wk->build_root);
+	fputs(",\n    \"command\": ", out);
+	compdb_write_json_str(out, cmd.buf);
+	fputs(",\n    \"file\": ", out);
+	compdb_write_json_str(out, src_path);
+	fputs(",\n    \"output\": ", out);
+	compdb_write_json_str(out, dest_path);
+	fputs("\n  }", out);
+	++ctx->compdb->len;
+}
+
 static enum iteration_result
 write_tgt_sources_iter(struct workspace *wk, void *_ctx, obj val)
 {
@@ -77,13 +149,16 @@ write_tgt_sources_iter(struct workspace *wk, void *_ctx, obj val)
 		obj_array_index(wk, rule_name_arr, 0, &rule_name);
 		obj_array_index(wk, rule_name_arr, 1, &specialized_rule);
 
-		if (!specialized_rule) {
-			if (!ctx->joined_args && !build_target_args(wk, ctx->proj, ctx->tgt, &ctx->joined_args)) {
-				return ir_err;
-			}
+		if (!ctx->joined_args && !build_target_args(wk, ctx->proj, ctx->tgt, &ctx->joined_args)) {
+			return ir_err;
 		}
 	}
 
+	obj args;
+	if (!obj_dict_geti(wk, ctx->joined_args, lang, &args)) {
+		UNREACHABLE;
+	}
+
 	SBUF(esc_dest_path);
 	SBUF(esc_path);
 
@@ -101,15 +176,11 @@ write_tgt_sources_iter(struct workspace *wk, void *_ctx, obj val)
 	fputc('\n', ctx->out);
 
 	if (!specialized_rule) {
-		obj args;
-		if (!obj_dict_geti(wk, ctx->joined_args, lang, &args)) {
-			UNREACHABLE;
-		}
-
 		fprintf(ctx->out,
 			" ARGS = %s\n", get_cstr(wk, args));
 	}
 
+	compdb_write_entry(wk, ctx, lang, args, src_path.buf, dest_path.buf);
 	return ir_cont;
 }
 
@@ -130,6 +201,7 @@ ninja_write_build_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *wc
 		.tgt = tgt,
 		.proj = wctx->proj,
 		.out = wctx->out,
+		.compdb = wctx->compdb,
 	};
 
 	enum linker_type linker;
@@ -12,6 +12,8 @@
 #include "backend/common_args.h"
 #include "backend/ninja.h"
 #include "backend/ninja/custom_target.h"
+#include "functions/environment.h"
+#include "functions/machine.h"
 #include "lang/serial.h"
 #include "lang/workspace.h"
 #include "log.h"
@@ -42,6 +44,99 @@ ninja_args_are_escapable(struct workspace *wk, obj arr)
 	return obj_array_foreach(wk, arr, NULL, ninja_args_are_escapable_iter);
 }
 
+static enum iteration_result
+env_is_set_only_iter(struct workspace *wk, void *_ctx, obj action)
+{
+	obj mode_num;
+	obj_array_index(wk, action, 0, &mode_num);
+	return get_obj_number(wk, mode_num) == environment_set_mode_set ? ir_cont : ir_err;
+}
+
+static enum iteration_result
+env_to_shell_assignments_iter(struct workspace *wk, void *_ctx, obj key, obj val)
+{
+	obj *assignments = _ctx;
+	const struct str *k = get_str(wk, key);
+	const char *p;
+
+	if (!k->len || ('0' <= *k->s && *k->s <= '9')) {
+		return ir_err;
+	}
+
+	for (p = k->s; *p; ++p) {
+		if (!(*p == '_'
+		      || ('a' <= *p && *p <= 'z')
+		      || ('A' <= *p && *p <= 'Z')
+		      || ('0' <= *p && *p <= '9'))) {
+			return ir_err;
+		}
+	}
+
+	if (!ninja_args_are_escapable_iter(wk, NULL, val)) {
+		return ir_err;
+	}
+
+	obj v;
+	make_obj(wk, &v, obj_array);
+	obj_array_push(wk, v, val);
+	str_app(wk, assignments, get_cstr(wk, key));
+	str_app(wk, assignments, "=");
+	str_app(wk, assignments, get_cstr(wk, join_args_shell_ninja(wk, v)));
+	str_app(wk, assignments, " ");
+	return ir_cont;
+}
+
+/*
+ * Ninja runs commands with /bin/sh on everything but windows, so an
+ * environment that only sets variables can be passed as assignments in
+ * front of the command rather than through a data file.
+ */
+static bool
+env_to_shell_assignments(struct workspace *wk, obj env, obj *res)
+{
+	if (machine_system() == machine_system_windows) {
+		return false;
+	}
+
+	if (get_obj_type(wk, env) == obj_environment
+	    && !obj_array_foreach(wk, get_obj_environment(wk, env)->actions, NULL, env_is_set_only_iter)) {
+		return false;
+	}
+
+	obj dict;
+	if (!environment_to_dict(wk, env, &dict)) {
+		return false;
+	}
+
+	*res = make_str(wk, "");
+	return obj_dict_foreach(wk, dict, res, env_to_shell_assignments_iter);
+}
+
+/*
+ * `muon internal exe` reads the #! line of scripts that are not
+ * executable, so only run a command directly if the kernel can run it too.
+ * Programs that don't exist yet are assumed to be executables built before
+ * the command is run.
+ */
+static bool
+ninja_cmd_is_executable(struct workspace *wk, obj args)
+{
+	obj arg0;
+	if (!get_obj_array(wk, args)->len) {
+		return false;
+	}
+	obj_array_index(wk, args, 0, &arg0);
+	const char *s = get_cstr(wk, arg0);
+
+	if (path_is_basename(s)) {
+		return true;
+	}
+
+	SBUF(path);
+	path_join(wk, &path, wk->build_root, s);
+	return fs_exe_exists(path.buf) || !fs_exists(path.buf);
+}
+
 static bool
 write_custom_target_dat(struct workspace *wk, struct obj_custom_target *tgt, obj data_obj, const char *dir, obj *res)
 {
@@ -100,55 +195,77 @@ ninja_write_custom_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *c
 		obj_array_push(wk, outputs, name);
 	}
 
-	make_obj(wk, &cmdline, obj_array);
-	obj_array_push(wk, cmdline, make_str(wk, wk->argv0));
-	obj_array_push(wk, cmdline, make_str(wk, "internal"));
-	obj_array_push(wk, cmdline, make_str(wk, "exe"));
+	obj tgt_args;
+	if (!arr_to_args(wk, 0, tgt->args, &tgt_args)) {
+		return ir_err;
+	}
 
-	if (tgt->flags & custom_target_capture) {
-		obj_array_push(wk, cmdline, make_str(wk, "-c"));
+	obj env_assignments = 0;
+	if (tgt->env && !env_to_shell_assignments(wk, tgt->env, &env_assignments)) {
+		env_assignments = 0;
+	}
 
-		obj elem;
-		obj_array_index(wk, tgt->output, 0, &elem);
+	/*
+	 * Run the command directly if possible, `muon internal exe` is only
+	 * needed to capture output, to load an environment or arguments that
+	 * can't be expressed in a shell command, to run scripts that aren't
+	 * executable, or on windows.
+	 */
+	bool direct = machine_system() != machine_system_windows
+		      && !(tgt->flags & custom_target_capture)
+		      && (!tgt->env || env_assignments)
+		      && ninja_args_are_escapable(wk, tgt_args)
+		      && ninja_cmd_is_executable(wk, tgt_args);
 
-		relativize_path_push(wk, elem, cmdline);
-	}
+	make_obj(wk, &cmdline, obj_array);
 
-	if (tgt->flags & custom_target_feed) {
-		obj_array_push(wk, cmdline, make_str(wk, "-f"));
+	if (direct) {
+		obj_array_extend_nodup(wk, cmdline, tgt_args);
+	} else {
+		obj_array_push(wk, cmdline, make_str(wk, wk->argv0));
+		obj_array_push(wk, cmdline, make_str(wk, "internal"));
+		obj_array_push(wk, cmdline, make_str(wk, "exe"));
 
-		obj elem;
-		obj_array_index(wk, tgt->input, 0, &elem);
+		if (tgt->flags & custom_target_capture) {
+			obj_array_push(wk, cmdline, make_str(wk, "-c"));
 
-		relativize_path_push(wk, elem, cmdline);
-	}
+			obj elem;
+			obj_array_index(wk, tgt->output, 0, &elem);
 
-	if (tgt->env) {
-		obj env_dat_path;
-		if (!write_custom_target_dat(wk, tgt, tgt->env, "custom_tgt_env", &env_dat_path)) {
-			return ir_err;
+			relativize_path_push(wk, elem, cmdline);
 		}
 
-		obj_array_push(wk, cmdline, make_str(wk, "-e"));
-		obj_array_push(wk, cmdline, env_dat_path);
-	}
+		if (tgt->flags & custom_target_feed) {
+			obj_array_push(wk, cmdline, make_str(wk, "-f"));
 
-	obj tgt_args;
-	if (!arr_to_args(wk, 0, tgt->args, &tgt_args)) {
-		return ir_err;
-	}
+			obj elem;
+			obj_array_index(wk, tgt->input, 0, &elem);
 
-	if (ninja_args_are_escapable(wk, tgt_args)) {
-		obj_array_push(wk, cmdline, make_str(wk, "--"));
-		obj_array_extend_nodup(wk, cmdline, tgt_args);
-	} else {
-		obj args_dat_path;
-		if (!write_custom_target_dat(wk, tgt, tgt_args, "custom_tgt_args", &args_dat_path)) {
-			return ir_err;
+			relativize_path_push(wk, elem, cmdline);
 		}
 
-		obj_array_push(wk, cmdline, make_str(wk, "-a"));
-		obj_array_push(wk, cmdline, args_dat_path);
+		if (tgt->env && !env_assignments) {
+			obj env_dat_path;
+			if (!write_custom_target_dat(wk, tgt, tgt->env, "custom_tgt_env", &env_dat_path)) {
+				return ir_err;
+			}
+
+			obj_array_push(wk, cmdline, make_str(wk, "-e"));
+			obj_array_push(wk, cmdline, env_dat_path);
+		}
+
+		if (ninja_args_are_escapable(wk, tgt_args)) {
+			obj_array_push(wk, cmdline, make_str(wk, "--"));
+			obj_array_extend_nodup(wk, cmdline, tgt_args);
+		} else {
+			obj args_dat_path;
+			if (!write_custom_target_dat(wk, tgt, tgt_args, "custom_tgt_args", &args_dat_path)) {
+				return ir_err;
+			}
+
+			obj_array_push(wk, cmdline, make_str(wk, "-a"));
+			obj_array_push(wk, cmdline, args_dat_path);
+		}
 	}
 
 	obj depends_rel;
@@ -163,6 +280,19 @@ ninja_write_custom_tgt(struct workspace *wk, obj tgt_id, struct write_tgt_ctx *c
 	inputs = inputs ? join_args_ninja(wk, inputs) : make_str(wk, "");
 	cmdline = join_args_shell_ninja(wk, cmdline);
 
+	if (env_assignments) {
+		cmdline = make_strf(wk, "%s%s", get_cstr(wk, env_assignments), get_cstr(wk, cmdline));
+	}
+
+	if (direct && (tgt->flags & custom_target_feed)) {
+		obj feed, elem;
+		make_obj(wk, &feed, obj_array);
+		obj_array_index(wk, tgt->input, 0, &elem);
+		relativize_path_push(wk, elem, feed);
+		str_app(wk, &cmdline, " < ");
+		str_app(wk, &cmdline, get_cstr(wk, join_args_shell_ninja(wk, feed)));
+	}
+
 	const char *rule;
 	if (tgt->depfile) {
 		rule = "CUSTOM_COMMAND_DEP";
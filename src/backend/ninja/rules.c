@@ -345,6 +345,11 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 	obj_array_push(wk, regen_args, make_str(wk, "-c"));
 	obj_array_push(wk, regen_args, make_str(wk, compiler_check_cache_path.buf));
 
+	/* -r is passed through $regenerate_flags, so that the reconfigure
+	 * target below can run the same command without it */
+	obj regen_cmd_head = join_args_shell(wk, regen_args);
+	make_obj(wk, &regen_args, obj_array);
+
 	obj_dict_foreach(wk, wk->global_opts, &regen_args, add_global_opts_set_from_env_iter);
 
 	uint32_t i;
@@ -357,7 +362,9 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 
 	fprintf(out,
 		"rule REGENERATE_BUILD\n"
-		" command = %s", get_cstr(wk, regen_cmd));
+		" command = %s $regenerate_flags %s",
+		get_cstr(wk, regen_cmd_head),
+		get_cstr(wk, regen_cmd));
 
 	fputs("\n description = Regenerating build files.\n"
 		" generator = 1\n"
@@ -372,6 +379,9 @@ ninja_write_rules(FILE *out, struct workspace *wk, struct project *main_proj,
 
 	fprintf(out,
 		"build build.ninja: REGENERATE_BUILD %s\n"
+		" regenerate_flags = -r\n"
+		" pool = console\n\n"
+		"build reconfigure: REGENERATE_BUILD\n"
 		" pool = console\n\n",
 		get_cstr(wk, join_args_ninja(wk, regenerate_deps_rel))
 		);
@@ -19,6 +19,9 @@ const struct output_path output_path = {
 	.install = "install.dat",
 	.compiler_check_cache = "compiler_check_cache.dat",
 	.option_info = "option_info.dat",
+	.test_durations = "test_durations.dat",
+	.regenerate_deps = "regenerate_deps.dat",
+	.ast_cache = "ast_cache",
 };
 
 FILE *
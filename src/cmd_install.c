@@ -21,6 +21,56 @@
 #include "platform/rpath_fixer.h"
 #include "platform/run_cmd.h"
 
+/*
+ * Modification time in nanoseconds, or whole seconds where struct stat
+ * doesn't have more.
+ */
+static int64_t
+install_mtime(const struct stat *sb)
+{
+#if defined(_WIN32)
+	return (int64_t)sb->st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	return (int64_t)sb->st_mtime * 1000000000 + sb->st_mtimensec;
+#else
+	return (int64_t)sb->st_mtim.tv_sec * 1000000000 + sb->st_mtim.tv_nsec;
+#endif
+}
+
+/*
+ * A file is considered up to date if the installed copy has the same size
+ * and is strictly newer than the source, this makes repeated installs into
+ * the same destination cheap.  A source rewritten within the timestamp
+ * resolution of the last install compares equal and is installed again.
+ */
+static bool
+install_file_is_up_to_date(const char *src, const char *dest)
+{
+	struct stat src_sb, dest_sb;
+
+	if (!fs_file_exists(dest) || fs_symlink_exists(src) || fs_symlink_exists(dest)) {
+		return false;
+	} else if (!fs_stat(src, &src_sb) || !fs_stat(dest, &dest_sb)) {
+		return false;
+	}
+
+	return S_ISREG(src_sb.st_mode)
+	       && src_sb.st_size == dest_sb.st_size
+	       && install_mtime(&src_sb) < install_mtime(&dest_sb);
+}
+
+static bool
+install_file(const char *src, const char *dest)
+{
+	if (install_file_is_up_to_date(src, dest)) {
+		LOG_I("up to date '%s'", dest);
+		return true;
+	}
+
+	LOG_I("install '%s' -> '%s'", src, dest);
+	return fs_copy_file(src, dest);
+}
+
 struct copy_subdir_ctx {
 	obj exclude_directories;
 	obj exclude_files;
@@ -81,9 +131,7 @@ copy_subdir_iter(void *_ctx, const char *path)
 			return ir_cont;
 		}
 
-		LOG_I("install '%s' -> '%s'", src.buf, dest.buf);
-
-		if (!fs_copy_file(src.buf, dest.buf)) {
+		if (!install_file(src.buf, dest.buf)) {
 			return ir_err;
 		}
 	} else {
@@ -103,8 +151,32 @@ struct install_ctx {
 	obj prefix;
 	obj full_prefix;
 	obj destdir;
+	/* dict of directories already created, most targets share a few */
+	obj created_dirs;
 };
 
+static bool
+install_mkdir_p(struct workspace *wk, struct install_ctx *ctx, const char *dir)
+{
+	obj v;
+	if (obj_dict_index_strn(wk, ctx->created_dirs, dir, strlen(dir), &v)) {
+		return true;
+	}
+
+	if (fs_exists(dir) && !fs_dir_exists(dir)) {
+		LOG_E("dest '%s' exists and is not a directory", dir);
+		return false;
+	}
+
+	if (!fs_mkdir_p(dir)) {
+		return false;
+	}
+
+	v = make_str(wk, dir);
+	obj_dict_set(wk, ctx->created_dirs, v, v);
+	return true;
+}
+
 static enum iteration_result
 install_iter(struct workspace *wk, void *_ctx, obj v_id)
 {
@@ -125,7 +197,10 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 
 	switch (in->type) {
 	case install_target_default:
-		LOG_I("install '%s' -> '%s'", src, dest);
+		/* install_file() reports regular files itself */
+		if (ctx->opts->dry_run || fs_dir_exists(src)) {
+			LOG_I("install '%s' -> '%s'", src, dest);
+		}
 		break;
 	case install_target_subdir:
 		LOG_I("install subdir '%s' -> '%s'", src, dest);
@@ -149,12 +224,7 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 	case install_target_symlink:
 		path_dirname(wk, &dest_dirname, dest);
 
-		if (fs_exists(dest_dirname.buf) && !fs_dir_exists(dest_dirname.buf)) {
-			LOG_E("dest '%s' exists and is not a directory", dest_dirname.buf);
-			return ir_err;
-		}
-
-		if (!fs_mkdir_p(dest_dirname.buf)) {
+		if (!install_mkdir_p(wk, ctx, dest_dirname.buf)) {
 			return ir_err;
 		}
 
@@ -164,7 +234,7 @@ install_iter(struct workspace *wk, void *_ctx, obj v_id)
 					return ir_err;
 				}
 			} else {
-				if (!fs_copy_file(src, dest)) {
+				if (!install_file(src, dest)) {
 					return ir_err;
 				}
 			}
@@ -299,6 +369,7 @@ install_run(struct install_options *opts)
 	struct install_ctx ctx = {
 		.opts = opts,
 	};
+	make_obj(&wk, &ctx.created_dirs, obj_dict);
 
 	obj install_targets, install_scripts, source_root;
 	obj_array_index(&wk, install, 0, &install_targets);
@@ -23,8 +23,6 @@
 #include "platform/term.h"
 #include "platform/timer.h"
 
-#define SLEEP_TIME 10000000 // 10ms
-
 enum test_result_status {
 	test_result_status_running,
 	test_result_status_ok,
@@ -48,6 +46,12 @@ struct test_result {
 struct run_test_ctx {
 	struct test_options *opts;
 	obj proj_name;
+	/* dict[project name -> dict[suites:test name -> ms]], loaded from the
+	 * previous run and rebuilt for the tests that still exist */
+	obj durations, new_durations;
+	obj proj_durations;
+	/* dict[test -> ms], the durations of the current project's tests */
+	obj test_durations;
 	obj collected_tests;
 	obj deps;
 	uint32_t proj_i;
@@ -70,6 +74,7 @@ struct run_test_ctx {
 	struct darr test_results;
 
 	struct test_result *jobs;
+	struct run_cmd_ctx **busy_cmd_ctxs;
 	uint32_t busy_jobs;
 	bool serial;
 };
@@ -585,6 +590,44 @@ free_slot:
 	}
 }
 
+/*
+ * Block until a running test produces output or exits, or until the next
+ * test timeout needs to be handled by collect_tests.
+ */
+static void
+wait_for_tests(struct run_test_ctx *ctx)
+{
+	uint32_t i, n = 0;
+	float wait = 1.0f;
+
+	for (i = 0; i < ctx->opts->jobs; ++i) {
+		struct test_result *res = &ctx->jobs[i];
+		if (!res->busy) {
+			continue;
+		}
+
+		ctx->busy_cmd_ctxs[n++] = &res->cmd_ctx;
+
+		if (res->timeout > 0.0f) {
+			float left = res->timeout - timer_end(&res->t);
+			if (res->status == test_result_status_timedout) {
+				// see force_kill in collect_tests
+				left += 0.5f;
+			}
+
+			if (left < wait) {
+				wait = left;
+			}
+		}
+	}
+
+	if (wait < 0.001f) {
+		wait = 0.001f;
+	}
+
+	run_cmd_wait(ctx->busy_cmd_ctxs, n, wait * 1000.0f + 1);
+}
+
 static void
 push_test(struct workspace *wk, struct run_test_ctx *ctx, struct obj_test *test,
 	const char *argstr, uint32_t argc, const char *envstr, uint32_t envc)
@@ -610,7 +653,7 @@ push_test(struct workspace *wk, struct run_test_ctx *ctx, struct obj_test *test,
 		}
 
 cont:
-		timer_sleep(SLEEP_TIME);
+		wait_for_tests(ctx);
 		collect_tests(wk, ctx);
 	}
 found_slot:
@@ -726,9 +769,56 @@ gather_project_tests_iter(struct workspace *wk, void *_ctx, obj val)
 	return ir_cont;
 }
 
+/*
+ * Test names only need to be unique within a suite, so durations are keyed
+ * by both.
+ */
+static obj
+test_duration_key(struct workspace *wk, struct obj_test *t)
+{
+	obj suites = 0;
+	if (t->suites) {
+		obj_array_join(wk, false, t->suites, make_str(wk, ","), &suites);
+	}
+
+	return make_strf(wk, "%s:%s", suites ? get_cstr(wk, suites) : "", get_cstr(wk, t->name));
+}
+
+static enum iteration_result
+carry_over_test_duration_iter(struct workspace *wk, void *_ctx, obj test)
+{
+	struct run_test_ctx *ctx = _ctx;
+	obj key = test_duration_key(wk, get_obj_test(wk, test)), old, dur;
+
+	if (obj_dict_index(wk, ctx->durations, ctx->proj_name, &old)
+	    && obj_dict_index(wk, old, key, &dur)) {
+		obj_dict_set(wk, ctx->proj_durations, key, dur);
+		obj_dict_seti(wk, ctx->test_durations, test, dur);
+	}
+
+	return ir_cont;
+}
+
+static int64_t
+test_duration(struct workspace *wk, struct run_test_ctx *ctx, obj test)
+{
+	obj dur;
+	if (obj_dict_geti(wk, ctx->test_durations, test, &dur)) {
+		return get_obj_number(wk, dur);
+	}
+
+	return INT64_MAX;
+}
+
+/*
+ * Tests are sorted by priority, with serial tests first.  Parallel tests
+ * are then sorted longest first, which keeps a long test from being
+ * started last and holding up the rest.
+ */
 static int32_t
 test_compare(struct workspace *wk, void *_ctx, obj t1_id, obj t2_id)
 {
+	struct run_test_ctx *ctx = _ctx;
 	struct obj_test *t1 = get_obj_test(wk, t1_id),
 			*t2 = get_obj_test(wk, t2_id);
 
@@ -740,7 +830,9 @@ test_compare(struct workspace *wk, void *_ctx, obj t1_id, obj t2_id)
 	} else if (p1 < p2) {
 		return 1;
 	} else if (t1->is_parallel && t2->is_parallel) {
-		return 0;
+		int64_t d1 = test_duration(wk, ctx, t1_id),
+			d2 = test_duration(wk, ctx, t2_id);
+		return d1 > d2 ? -1 : (d1 < d2 ? 1 : 0);
 	} else if (t1->is_parallel) {
 		return 1;
 	} else {
@@ -774,9 +866,17 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	ctx->stats.error_count = 0;
 	ctx->stats.test_len = 0;
 
+	/* Only durations of tests that are still defined are kept, whether or
+	 * not they are run this time. */
+	ctx->proj_name = proj_name;
+	make_obj(wk, &ctx->proj_durations, obj_dict);
+	make_obj(wk, &ctx->test_durations, obj_dict);
+	obj_dict_set(wk, ctx->new_durations, proj_name, ctx->proj_durations);
+	obj_array_foreach(wk, unfiltered_tests, ctx, carry_over_test_duration_iter);
+
 	make_obj(wk, &ctx->collected_tests, obj_array);
 	obj_array_foreach(wk, unfiltered_tests, ctx, gather_project_tests_iter);
-	obj_array_sort(wk, NULL, ctx->collected_tests, test_compare, &tests);
+	obj_array_sort(wk, ctx, ctx->collected_tests, test_compare, &tests);
 
 	if (ctx->opts->list) {
 		obj_array_foreach(wk, tests, ctx, list_tests_iter);
@@ -797,7 +897,7 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 
 	ctx->stats.ran_tests = true;
 
-	ctx->proj_name = proj_name;
+	uint32_t results_start = ctx->test_results.len;
 
 	if (!obj_array_foreach(wk, tests, ctx, run_test)) {
 		return ir_err;
@@ -808,10 +908,20 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	}
 
 	while (ctx->busy_jobs) {
-		timer_sleep(SLEEP_TIME);
+		wait_for_tests(ctx);
 		collect_tests(wk, ctx);
 	}
 
+	uint32_t i;
+	for (i = results_start; i < ctx->test_results.len; ++i) {
+		struct test_result *res = darr_get(&ctx->test_results, i);
+
+		obj dur;
+		make_obj(wk, &dur, obj_number);
+		set_obj_number(wk, dur, res->dur * 1000.0f);
+		obj_dict_set(wk, ctx->proj_durations, test_duration_key(wk, res->test), dur);
+	}
+
 	log_plain("\n");
 
 	++ctx->proj_i;
@@ -819,6 +929,13 @@ run_project_tests(struct workspace *wk, void *_ctx, obj proj_name, obj arr)
 	return ir_cont;
 }
 
+static bool
+write_test_durations(struct workspace *wk, void *_ctx, FILE *out)
+{
+	struct run_test_ctx *ctx = _ctx;
+	return serial_dump(wk, ctx->new_durations, out);
+}
+
 bool
 tests_run(struct test_options *opts, const char *argv0)
 {
@@ -840,6 +957,7 @@ tests_run(struct test_options *opts, const char *argv0)
 
 	darr_init(&ctx.test_results, 32, sizeof(struct test_result));
 	ctx.jobs = z_calloc(ctx.opts->jobs, sizeof(struct test_result));
+	ctx.busy_cmd_ctxs = z_calloc(ctx.opts->jobs, sizeof(struct run_cmd_ctx *));
 
 	{ // load global opts
 		obj option_info;
@@ -885,6 +1003,11 @@ tests_run(struct test_options *opts, const char *argv0)
 		goto ret;
 	}
 
+	if (!serial_load_from_private_dir(&wk, &ctx.durations, output_path.test_durations)) {
+		make_obj(&wk, &ctx.durations, obj_dict);
+	}
+	make_obj(&wk, &ctx.new_durations, obj_dict);
+
 	if (!load_test_setup(&wk, &ctx, tests_dict)) {
 		goto ret;
 	}
@@ -898,6 +1021,10 @@ tests_run(struct test_options *opts, const char *argv0)
 		goto ret;
 	}
 
+	if (ctx.stats.ran_tests) {
+		with_open(output_path.private_dir, output_path.test_durations, &wk, &ctx, write_test_durations);
+	}
+
 	if (!ctx.stats.ran_tests) {
 		LOG_I("no %ss defined", test_category_label(opts->cat));
 	} else {
@@ -949,5 +1076,6 @@ ret:
 	workspace_destroy_bare(&wk);
 	darr_destroy(&ctx.test_results);
 	z_free(ctx.jobs);
+	z_free(ctx.busy_cmd_ctxs);
 	return ret;
 }
@@ -10,6 +10,7 @@
 #include <string.h>
 
 #include "coerce.h"
+#include "dir_cache.h"
 #include "functions/environment.h"
 #include "lang/interpreter.h"
 #include "log.h"
@@ -317,7 +318,7 @@ coerce_requirement(struct workspace *wk, struct args_kw *kw_required, enum requi
 	return true;
 }
 
-typedef bool (*exists_func)(const char *);
+typedef bool (*exists_func)(struct workspace *wk, const char *);
 
 enum coerce_into_files_mode {
 	mode_input,
@@ -376,7 +377,7 @@ coerce_into_file(struct workspace *wk, struct coerce_into_files_ctx *ctx, obj va
 				return ir_err;
 			}
 
-			if (!ctx->exists(get_file_path(wk, *file))) {
+			if (!ctx->exists(wk, get_file_path(wk, *file))) {
 				interp_error(wk, ctx->node, "%s %o does not exist", ctx->type, val);
 				return ir_err;
 			}
@@ -503,7 +504,7 @@ coerce_output_files(struct workspace *wk, uint32_t node, obj val, const char *ou
 bool
 coerce_files(struct workspace *wk, uint32_t node, obj val, obj *res)
 {
-	return _coerce_files(wk, node, val, res, "file", fs_file_exists, mode_input, 0);
+	return _coerce_files(wk, node, val, res, "file", dir_cache_file_exists, mode_input, 0);
 }
 
 bool
@@ -513,7 +514,7 @@ coerce_file(struct workspace *wk, uint32_t node, obj val, obj *res)
 		.node = node,
 		.arr = *res,
 		.type = "file",
-		.exists = fs_file_exists,
+		.exists = dir_cache_file_exists,
 		.mode = mode_input,
 	};
 
@@ -523,7 +524,7 @@ coerce_file(struct workspace *wk, uint32_t node, obj val, obj *res)
 bool
 coerce_dirs(struct workspace *wk, uint32_t node, obj val, obj *res)
 {
-	return _coerce_files(wk, node, val, res, "directory", fs_dir_exists, mode_input, 0);
+	return _coerce_files(wk, node, val, res, "directory", dir_cache_dir_exists, mode_input, 0);
 }
 
 struct include_directories_iter_ctx {
@@ -559,7 +560,7 @@ include_directories_iter(struct workspace *wk, void *_ctx, obj v)
 
 	p = get_cstr(wk, path);
 
-	if (!fs_dir_exists(p)) {
+	if (!dir_cache_dir_exists(wk, p)) {
 		interp_error(wk, ctx->node, "directory '%s' does not exist", get_cstr(wk, path));
 		return ir_err;
 	}
@@ -0,0 +1,308 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <string.h>
+
+#include "dir_cache.h"
+#include "lang/workspace.h"
+#include "platform/filesystem.h"
+#include "platform/path.h"
+
+#define DIR_CACHE_BUCKET_SIZE (64 * 1024)
+
+enum dir_cache_type {
+	dir_cache_type_missing,
+	dir_cache_type_file,
+	dir_cache_type_dir,
+	dir_cache_type_other,
+	/* not known from the listing, check on disk */
+	dir_cache_type_unknown,
+};
+
+static const enum dir_cache_type dir_cache_entry_types[] = {
+	[fs_dir_entry_type_unknown] = dir_cache_type_unknown,
+	[fs_dir_entry_type_file] = dir_cache_type_file,
+	[fs_dir_entry_type_dir] = dir_cache_type_dir,
+	[fs_dir_entry_type_other] = dir_cache_type_other,
+};
+
+struct dir_cache_dir {
+	/* name -> enum dir_cache_type */
+	struct hash names;
+	bool listed;
+};
+
+static struct dir_cache *
+dir_cache_get(struct workspace *wk)
+{
+	struct dir_cache *dc = &wk->dir_cache;
+
+	if (!dc->init) {
+		hash_init_str(&dc->dirs, 64);
+		darr_init(&dc->dirs_data, 64, sizeof(struct dir_cache_dir));
+		bucket_array_init(&dc->chrs, DIR_CACHE_BUCKET_SIZE, 1);
+		dc->init = true;
+	}
+
+	return dc;
+}
+
+static bool
+path_is_in(const char *base, const char *path)
+{
+	uint32_t len = strlen(base);
+	return strncmp(base, path, len) == 0 && (path[len] == PATH_SEP || !path[len]);
+}
+
+/*
+ * Only paths in the source tree are cached.  The build directory is
+ * written to during setup, and paths outside of the project are rare
+ * enough not to matter.
+ */
+static bool
+dir_cache_covers(struct workspace *wk, const char *path)
+{
+	return wk->source_root && *wk->source_root
+	       && path_is_in(wk->source_root, path)
+	       && !(wk->build_root && *wk->build_root && path_is_in(wk->build_root, path));
+}
+
+static const char *
+dir_cache_strdup(struct dir_cache *dc, const char *s, uint32_t len)
+{
+	char *r = bucket_array_pushn(&dc->chrs, s, len, len + 1);
+	r[len] = 0;
+	return r;
+}
+
+struct dir_cache_list_ctx {
+	struct dir_cache *dc;
+	struct dir_cache_dir *dir;
+};
+
+static enum iteration_result
+dir_cache_list_iter(void *_ctx, const char *name, enum fs_dir_entry_type t)
+{
+	struct dir_cache_list_ctx *ctx = _ctx;
+
+	uint32_t len = strlen(name);
+	if (len + 1 >= DIR_CACHE_BUCKET_SIZE) {
+		return ir_cont;
+	}
+
+	hash_set_str(&ctx->dir->names, dir_cache_strdup(ctx->dc, name, len), dir_cache_entry_types[t]);
+	return ir_cont;
+}
+
+static enum dir_cache_type
+dir_cache_type_on_disk(const char *path)
+{
+	enum fs_dir_entry_type t;
+	return fs_entry_type(path, &t) ? dir_cache_entry_types[t] : dir_cache_type_missing;
+}
+
+static enum dir_cache_type dir_cache_lookup(struct workspace *wk, const char *path);
+
+/*
+ * Returns the listing of dir, reading it if this is the first time it is
+ * needed.  Returns NULL if the listing can't be used.
+ */
+static struct dir_cache_dir *
+dir_cache_get_dir(struct workspace *wk, struct dir_cache *dc, const char *dir, uint32_t dir_len)
+{
+	uint64_t *v;
+
+	if ((v = hash_get_str(&dc->dirs, dir))) {
+		return darr_get(&dc->dirs_data, *v);
+	} else if (dir_len + 1 >= DIR_CACHE_BUCKET_SIZE || !dir_cache_covers(wk, dir)) {
+		return NULL;
+	}
+
+	struct dir_cache_dir d = { 0 };
+	hash_init_str(&d.names, 16);
+
+	switch (dir_cache_lookup(wk, dir)) {
+	case dir_cache_type_dir:
+		d.listed = true;
+		break;
+	case dir_cache_type_unknown:
+		if (fs_dir_exists(dir)) {
+			d.listed = true;
+			break;
+		}
+	/* fallthrough */
+	default:
+		/* dir doesn't exist, so it is empty */
+		break;
+	}
+
+	if (d.listed) {
+		++dc->stats.dirs_read;
+		d.listed = fs_dir_foreach_typed(dir, &(struct dir_cache_list_ctx) { .dc = dc, .dir = &d },
+			dir_cache_list_iter);
+	} else {
+		d.listed = true;
+	}
+
+	uint32_t idx = darr_push(&dc->dirs_data, &d);
+	hash_set_str(&dc->dirs, dir_cache_strdup(dc, dir, dir_len), idx);
+	return darr_get(&dc->dirs_data, idx);
+}
+
+static enum dir_cache_type
+dir_cache_lookup(struct workspace *wk, const char *path)
+{
+	struct dir_cache *dc = dir_cache_get(wk);
+	const char *name;
+	uint64_t *v;
+
+	if (strcmp(path, wk->source_root) == 0) {
+		return dir_cache_type_dir;
+	} else if (!(name = strrchr(path, PATH_SEP))) {
+		return dir_cache_type_unknown;
+	}
+
+	SBUF(dir);
+	sbuf_pushn(wk, &dir, path, name == path ? 1 : name - path);
+	++name;
+
+	struct dir_cache_dir *d;
+	if (!(d = dir_cache_get_dir(wk, dc, dir.buf, dir.len)) || !d->listed) {
+		return dir_cache_type_unknown;
+	}
+
+	if (!(v = hash_get_str(&d->names, name))) {
+		++dc->stats.hits;
+		return dir_cache_type_missing;
+	} else if (*v == dir_cache_type_unknown) {
+		/* a symlink, or the listing had no types */
+		*v = dir_cache_type_on_disk(path);
+	} else {
+		++dc->stats.hits;
+	}
+
+	return *v;
+}
+
+/*
+ * A missing entry is checked on disk as well.  It is cheap since it is
+ * rare, and it keeps case insensitive file systems working, where the
+ * listing has a different spelling of the name.
+ */
+bool
+dir_cache_exists(struct workspace *wk, const char *path)
+{
+	if (!dir_cache_covers(wk, path)) {
+		return fs_exists(path);
+	}
+
+	switch (dir_cache_lookup(wk, path)) {
+	case dir_cache_type_file:
+	case dir_cache_type_dir:
+	case dir_cache_type_other:
+		return true;
+	default:
+		return fs_exists(path);
+	}
+}
+
+bool
+dir_cache_file_exists(struct workspace *wk, const char *path)
+{
+	if (!dir_cache_covers(wk, path)) {
+		return fs_file_exists(path);
+	}
+
+	switch (dir_cache_lookup(wk, path)) {
+	case dir_cache_type_file:
+		return true;
+	case dir_cache_type_dir:
+	case dir_cache_type_other:
+		return false;
+	default:
+		return fs_file_exists(path);
+	}
+}
+
+bool
+dir_cache_dir_exists(struct workspace *wk, const char *path)
+{
+	if (!dir_cache_covers(wk, path)) {
+		return fs_dir_exists(path);
+	}
+
+	switch (dir_cache_lookup(wk, path)) {
+	case dir_cache_type_dir:
+		return true;
+	case dir_cache_type_file:
+	case dir_cache_type_other:
+		return false;
+	default:
+		return fs_dir_exists(path);
+	}
+}
+
+void
+dir_cache_add_regenerate_dep(struct workspace *wk, const char *path)
+{
+	SBUF(dir);
+	path_dirname(wk, &dir, path);
+
+	if (!dir_cache_covers(wk, dir.buf) || !dir_cache_dir_exists(wk, dir.buf)) {
+		return;
+	}
+
+	/* a missing entry is checked on disk, see dir_cache_exists */
+	enum dir_cache_type t = dir_cache_lookup(wk, path);
+	if (t == dir_cache_type_missing || t == dir_cache_type_unknown) {
+		t = dir_cache_type_on_disk(path);
+	}
+
+	obj type;
+	make_obj(wk, &type, obj_number);
+	set_obj_number(wk, type, t);
+	obj_dict_set(wk, wk->regenerate_queries, make_str(wk, path), type);
+
+	workspace_add_regenerate_deps(wk, sbuf_into_str(wk, &dir));
+}
+
+obj
+dir_cache_path_type(struct workspace *wk, const char *path)
+{
+	obj type;
+	make_obj(wk, &type, obj_number);
+	set_obj_number(wk, type, dir_cache_type_on_disk(path));
+	return type;
+}
+
+static void
+dir_cache_free(struct dir_cache *dc)
+{
+	uint32_t i;
+	for (i = 0; i < dc->dirs_data.len; ++i) {
+		hash_destroy(&((struct dir_cache_dir *)darr_get(&dc->dirs_data, i))->names);
+	}
+
+	hash_destroy(&dc->dirs);
+	darr_destroy(&dc->dirs_data);
+	bucket_array_destroy(&dc->chrs);
+	dc->init = false;
+}
+
+void
+dir_cache_clear(struct workspace *wk)
+{
+	if (wk->dir_cache.init) {
+		dir_cache_free(&wk->dir_cache);
+	}
+}
+
+void
+dir_cache_destroy(struct workspace *wk)
+{
+	dir_cache_clear(wk);
+}
@@ -38,11 +38,10 @@ copy_data(struct archive *ar, struct archive *aw)
 	}
 }
 
-bool
-muon_archive_extract(const char *buf, size_t size, const char *dest_path)
+static bool
+extract(struct archive *a, const char *dest_path)
 {
 	bool res = false;
-	struct archive *a;
 	struct archive *ext;
 	struct archive_entry *entry;
 	int flags;
@@ -54,19 +53,10 @@ muon_archive_extract(const char *buf, size_t size, const char *dest_path)
 	flags |= ARCHIVE_EXTRACT_ACL;
 	flags |= ARCHIVE_EXTRACT_FFLAGS;
 
-	a = archive_read_new();
-	archive_read_support_format_all(a);
-	archive_read_support_filter_all(a);
 	ext = archive_write_disk_new();
 	archive_write_disk_set_options(ext, flags);
 	archive_write_disk_set_standard_lookup(ext);
 
-	if ((r = archive_read_open_memory(a, buf, size))) {
-		// may not work, a might not be initialized ??
-		LOG_E("error opening archive: %s\n", archive_error_string(a));
-		goto ret;
-	}
-
 	SBUF_manual(path);
 
 	while (true) {
@@ -106,10 +96,8 @@ muon_archive_extract(const char *buf, size_t size, const char *dest_path)
 ret:
 	sbuf_destroy(&path);
 
-	if (a) {
-		archive_read_close(a);
-		archive_read_free(a);
-	}
+	archive_read_close(a);
+	archive_read_free(a);
 
 	if (ext) {
 		archive_write_close(ext);
@@ -117,3 +105,43 @@ ret:
 	}
 	return res;
 }
+
+static struct archive *
+archive_read_new_all(void)
+{
+	struct archive *a;
+
+	a = archive_read_new();
+	archive_read_support_format_all(a);
+	archive_read_support_filter_all(a);
+	return a;
+}
+
+bool
+muon_archive_extract(const char *buf, size_t size, const char *dest_path)
+{
+	struct archive *a = archive_read_new_all();
+
+	if (archive_read_open_memory(a, buf, size) != ARCHIVE_OK) {
+		LOG_E("error opening archive: %s", archive_error_string(a));
+		archive_read_free(a);
+		return false;
+	}
+
+	return extract(a, dest_path);
+}
+
+bool
+muon_archive_extract_file(const char *path, const char *dest_path)
+{
+	struct archive *a = archive_read_new_all();
+
+	/* libarchive reads the file in blocks of this size rather than all at once */
+	if (archive_read_open_filename(a, path, BUF_SIZE_32k) != ARCHIVE_OK) {
+		LOG_E("error opening archive '%s': %s", path, archive_error_string(a));
+		archive_read_free(a);
+		return false;
+	}
+
+	return extract(a, dest_path);
+}
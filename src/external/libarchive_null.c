@@ -16,3 +16,10 @@ muon_archive_extract(const char *buf, size_t size, const char *dest_path)
 	LOG_W("libarchive not enabled");
 	return false;
 }
+
+bool
+muon_archive_extract_file(const char *path, const char *dest_path)
+{
+	LOG_W("libarchive not enabled");
+	return false;
+}
@@ -43,102 +43,232 @@ muon_curl_deinit(void)
 	fetch_ctx.init = false;
 }
 
-struct write_data_ctx {
-	uint8_t *buf;
-	uint64_t len, cap;
+struct fetch_transfer {
+	struct muon_curl_fetch_req *req;
+	CURL *handle;
+	char errbuf[CURL_ERROR_SIZE];
+	bool write_failed;
 };
 
 static size_t
-write_data(void *src, size_t size, size_t nmemb, void *_ctx)
+fetch_transfer_write(void *src, size_t size, size_t nmemb, void *_ctx)
 {
-	struct write_data_ctx *ctx = _ctx;
-	uint64_t want_to_write = size * nmemb;
+	struct fetch_transfer *t = _ctx;
+	uint64_t len = size * nmemb;
 
-	if (want_to_write + ctx->len > ctx->cap) {
-		ctx->cap = want_to_write + ctx->len;
-		ctx->buf = z_realloc(ctx->buf, ctx->cap);
+	if (!t->req->write(t->req->ctx, src, len)) {
+		t->write_failed = true;
+		return 0;
 	}
 
-	memcpy(&ctx->buf[ctx->len], src, want_to_write);
-	ctx->len += want_to_write;
+	return len;
+}
 
-	return nmemb;
+static void
+fetch_transfer_log_err(struct fetch_transfer *t, CURLcode err)
+{
+	if (t->write_failed) {
+		LOG_E("failed to store data fetched from '%s'", t->req->url);
+	} else if (*t->errbuf) {
+		LOG_E("curl failed to fetch '%s': %s", t->req->url, t->errbuf);
+	} else if (err != CURLE_OK) {
+		LOG_E("curl failed to fetch '%s': %s", t->req->url, curl_easy_strerror(err));
+	} else {
+		LOG_E("curl failed to fetch '%s'", t->req->url);
+	}
 }
 
-bool
-muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
+static void
+fetch_transfer_finish(CURLM *multi, struct fetch_transfer *t)
 {
-	CURL *curl_handle;
-	CURLcode err;
-	char errbuf[CURL_ERROR_SIZE] = { 0 };
+	curl_multi_remove_handle(multi, t->handle);
+	curl_easy_cleanup(t->handle);
+	t->handle = NULL;
+}
 
-	LOG_I("fetching '%s'", url);
+static bool
+fetch_transfer_start(CURLM *multi, struct fetch_transfer *t)
+{
+	CURLcode err = CURLE_OK;
 
-	if (!fetch_ctx.init) {
-		LOG_E("curl is not initialized");
-		goto err0;
-	}
+	LOG_I("fetching '%s'", t->req->url);
 
-	if (!(curl_handle = curl_easy_init())) {
+	if (!(t->handle = curl_easy_init())) {
 		LOG_E("failed to get curl handle");
-		goto err0;
+		return false;
 	}
 
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_ERRORBUFFER, errbuf)) != CURLE_OK) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_ERRORBUFFER, t->errbuf)) != CURLE_OK) {
+		goto err;
 	}
 
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_FOLLOWLOCATION, 1) != CURLE_OK)) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_FOLLOWLOCATION, 1L)) != CURLE_OK) {
+		goto err;
 	}
 
-	/* set URL to get here */
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_URL, url)) != CURLE_OK) {
-		goto err1;
+	/* treat http errors as failures rather than fetching the error page */
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_FAILONERROR, 1L)) != CURLE_OK) {
+		goto err;
 	}
 
-	/* Switch on full protocol/debug output while testing */
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_VERBOSE, 0L)) != CURLE_OK) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_URL, t->req->url)) != CURLE_OK) {
+		goto err;
 	}
 
-	/* disable progress meter, set to 0L to enable it */
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_NOPROGRESS, 1L)) != CURLE_OK) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_NOPROGRESS, 1L)) != CURLE_OK) {
+		goto err;
 	}
 
-	/* send all data to this function  */
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, write_data)) != CURLE_OK) {
-		goto err1;
+	/* bound the size of each chunk handed to the write callback */
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_BUFFERSIZE, (long)MUON_CURL_FETCH_BUF_SIZE)) != CURLE_OK) {
+		goto err;
 	}
 
-	struct write_data_ctx ctx = { 0 };
-	/* write the page body to this file handle */
-	if ((err = curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &ctx)) != CURLE_OK) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_WRITEFUNCTION, fetch_transfer_write)) != CURLE_OK) {
+		goto err;
 	}
 
-	/* get it! */
-	if ((err = curl_easy_perform(curl_handle)) != CURLE_OK) {
-		goto err1;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_WRITEDATA, t)) != CURLE_OK) {
+		goto err;
 	}
 
-	*buf = ctx.buf;
-	*len = ctx.len;
+	if ((err = curl_easy_setopt(t->handle, CURLOPT_PRIVATE, t)) != CURLE_OK) {
+		goto err;
+	}
+
+	if (curl_multi_add_handle(multi, t->handle) != CURLM_OK) {
+		goto err;
+	}
 
-	/* cleanup curl stuff */
-	curl_easy_cleanup(curl_handle);
 	return true;
+err:
+	fetch_transfer_log_err(t, err);
+	curl_easy_cleanup(t->handle);
+	t->handle = NULL;
+	return false;
+}
 
-err1:
-	if (*errbuf) {
-		LOG_E("curl failed to fetch '%s': %s", url, errbuf);
-	} else if (err != CURLE_OK) {
-		LOG_E("curl failed to fetch '%s': %s", url, curl_easy_strerror(err));
-	} else {
-		LOG_E("curl failed to fetch '%s'", url);
+bool
+muon_curl_fetch_many(struct muon_curl_fetch_req *reqs, uint32_t len, uint32_t max_parallel)
+{
+	bool res = true;
+	uint32_t i, next = 0, running = 0;
+	CURLM *multi;
+	CURLMcode merr;
+	CURLMsg *msg;
+	int still_running, msgs_left;
+
+	if (!fetch_ctx.init) {
+		LOG_E("curl is not initialized");
+		return false;
 	}
-	curl_easy_cleanup(curl_handle);
-err0:
-	return false;
+
+	if (!(multi = curl_multi_init())) {
+		LOG_E("failed to get curl multi handle");
+		return false;
+	}
+
+	if (!max_parallel) {
+		max_parallel = 1;
+	}
+
+	struct fetch_transfer *transfers = z_calloc(len, sizeof(struct fetch_transfer));
+	for (i = 0; i < len; ++i) {
+		reqs[i].ok = false;
+		transfers[i].req = &reqs[i];
+	}
+
+	while (next < len || running) {
+		for (; next < len && running < max_parallel; ++next) {
+			if (fetch_transfer_start(multi, &transfers[next])) {
+				++running;
+			} else {
+				res = false;
+			}
+		}
+
+		if ((merr = curl_multi_perform(multi, &still_running)) != CURLM_OK) {
+			LOG_E("curl failed: %s", curl_multi_strerror(merr));
+			res = false;
+			break;
+		}
+
+		while ((msg = curl_multi_info_read(multi, &msgs_left))) {
+			struct fetch_transfer *t;
+
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
+
+			curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, (char **)&t);
+
+			if (msg->data.result == CURLE_OK && !t->write_failed) {
+				t->req->ok = true;
+			} else {
+				fetch_transfer_log_err(t, msg->data.result);
+				res = false;
+			}
+
+			fetch_transfer_finish(multi, t);
+			--running;
+		}
+
+		if (running && (merr = curl_multi_poll(multi, NULL, 0, 1000, NULL)) != CURLM_OK) {
+			LOG_E("curl failed: %s", curl_multi_strerror(merr));
+			res = false;
+			break;
+		}
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (transfers[i].handle) {
+			fetch_transfer_finish(multi, &transfers[i]);
+		}
+	}
+
+	z_free(transfers);
+	curl_multi_cleanup(multi);
+	return res;
+}
+
+struct write_data_ctx {
+	uint8_t *buf;
+	uint64_t len, cap;
+};
+
+static bool
+write_data(void *_ctx, const uint8_t *src, uint64_t len)
+{
+	struct write_data_ctx *ctx = _ctx;
+
+	if (len + ctx->len > ctx->cap) {
+		ctx->cap = len + ctx->len;
+		ctx->buf = z_realloc(ctx->buf, ctx->cap);
+	}
+
+	memcpy(&ctx->buf[ctx->len], src, len);
+	ctx->len += len;
+	return true;
+}
+
+bool
+muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
+{
+	struct write_data_ctx ctx = { 0 };
+	struct muon_curl_fetch_req req = {
+		.url = url,
+		.write = write_data,
+		.ctx = &ctx,
+	};
+
+	if (!muon_curl_fetch_many(&req, 1, 1)) {
+		if (ctx.buf) {
+			z_free(ctx.buf);
+		}
+		return false;
+	}
+
+	*buf = ctx.buf;
+	*len = ctx.len;
+	return true;
 }
@@ -26,3 +26,10 @@ muon_curl_fetch(const char *url, uint8_t **buf, uint64_t *len)
 	LOG_W("libcurl not enabled");
 	return false;
 }
+
+bool
+muon_curl_fetch_many(struct muon_curl_fetch_req *reqs, uint32_t len, uint32_t max_parallel)
+{
+	LOG_W("libcurl not enabled");
+	return false;
+}
@@ -166,7 +166,7 @@ dump_function_signature(struct workspace *wk,
 				continue;
 			}
 
-			str_appf(wk, s, "    %s\n", dump_type(wk, posargs[i].type));
+			str_appf(wk, &s, "    %s\n", dump_type(wk, posargs[i].type));
 		}
 
 		const char *ts = get_cstr(wk, s);
@@ -178,7 +178,7 @@ dump_function_signature(struct workspace *wk,
 	if (optargs) {
 		s = make_str(wk, "");
 		for (i = 0; optargs[i].type != ARG_TYPE_NULL; ++i) {
-			str_appf(wk, s, "    %s\n", dump_type(wk, optargs[i].type));
+			str_appf(wk, &s, "    %s\n", dump_type(wk, optargs[i].type));
 		}
 		sig->optargs = get_cstr(wk, s);
 	}
@@ -196,7 +196,7 @@ dump_function_signature(struct workspace *wk,
 
 		s = make_str(wk, "");
 		for (i = 0; i < kwargs_list.len; ++i) {
-			str_app(wk, s, *(const char **)darr_get(&kwargs_list, i));
+			str_app(wk, &s, *(const char **)darr_get(&kwargs_list, i));
 
 		}
 		sig->kwargs = get_cstr(wk, s);
@@ -743,6 +743,44 @@ func_lookup(const struct func_impl_name *impl_tbl, const char *name)
 	return NULL;
 }
 
+/*
+ * Function and method calls resolve their implementation once per name node.
+ * The table searched depends only on the language mode, the receiver type,
+ * and, for modules, the module, so those make up the cache key.  Methods of
+ * the module object itself, i.e. found(), use module_count as the module.
+ */
+static uint16_t
+func_cache_key(struct workspace *wk, bool have_rcvr, enum obj_type rcvr_type, enum module mod)
+{
+	uint32_t k = 0;
+
+	if (have_rcvr) {
+		k = rcvr_type == obj_module ? obj_type_count + 1 + mod : 1 + rcvr_type;
+	}
+
+	return 1 + k * language_mode_count + wk->lang_mode;
+}
+
+static const struct func_impl_name *
+func_lookup_cached(struct workspace *wk, uint32_t name_node, uint16_t key,
+	const struct func_impl_name *impl_tbl)
+{
+	struct node *n = get_node(wk->ast, name_node);
+
+	if (n->fcache_key == key) {
+		return &impl_tbl[n->fcache_idx];
+	}
+
+	const struct func_impl_name *fi;
+	if (!impl_tbl || !(fi = func_lookup(impl_tbl, n->dat.s))) {
+		return NULL;
+	}
+
+	n->fcache_key = key;
+	n->fcache_idx = fi - impl_tbl;
+	return fi;
+}
+
 const char *
 func_name_str(bool have_rcvr, enum obj_type rcvr_type, const char *name)
 {
@@ -789,11 +827,21 @@ builtin_run(struct workspace *wk, bool have_rcvr, obj rcvr_id, uint32_t node_id,
 	if (have_rcvr && rcvr_type == obj_module) {
 		struct obj_module *m = get_obj_module(wk, rcvr_id);
 		enum module mod = m->module;
+		uint16_t key = func_cache_key(wk, true, rcvr_type, module_count);
+		uint16_t cached = get_node(wk->ast, name_node)->fcache_key;
+
+		if (cached == key
+		    || (cached != func_cache_key(wk, true, rcvr_type, mod) && strcmp(name, "found") == 0)) {
+			impl_tbl = impl_tbl_module;
+		} else {
+			key = func_cache_key(wk, true, rcvr_type, mod);
+			impl_tbl = module_func_tbl[mod][wk->lang_mode];
+		}
 
-		if (!m->found && strcmp(name, "found") != 0) {
+		if (!m->found && impl_tbl != impl_tbl_module) {
 			interp_error(wk, name_node, "invalid attempt to use not-found module");
 			return false;
-		} else if (!(fi = module_func_lookup(wk, name, mod))) {
+		} else if (!(fi = func_lookup_cached(wk, name_node, key, impl_tbl))) {
 			if (!m->has_impl) {
 				interp_error(wk, name_node, "module '%s' is unimplemented,\n"
 					"  If you would like to make your build files portable to muon, use"
@@ -814,7 +862,8 @@ builtin_run(struct workspace *wk, bool have_rcvr, obj rcvr_id, uint32_t node_id,
 			return false;
 		}
 
-		if (!(fi = func_lookup(impl_tbl, name))) {
+		if (!(fi = func_lookup_cached(wk, name_node,
+			func_cache_key(wk, have_rcvr, rcvr_type, 0), impl_tbl))) {
 			if (rcvr_type == obj_disabler) {
 				*res = disabler_id;
 				return true;
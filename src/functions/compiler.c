@@ -23,8 +23,10 @@
 #include "functions/kernel/custom_target.h"
 #include "functions/kernel/dependency.h"
 #include "lang/interpreter.h"
+#include "lang/serial.h"
 #include "log.h"
 #include "platform/filesystem.h"
+#include "platform/mem.h"
 #include "platform/path.h"
 #include "platform/run_cmd.h"
 #include "sha_256.h"
@@ -125,36 +127,397 @@ add_include_directory_args(struct workspace *wk, struct args_kw *inc, struct bui
 	return true;
 }
 
+/*
+ * If MUON_CACHE_DIR is set, compiler check results are shared between build
+ * directories.  Each compiler gets a file in $MUON_CACHE_DIR/compiler_checks,
+ * named after a hash of its command, the size and mtime of its executables,
+ * its version, and the environment variables that change where it looks for
+ * headers and libraries.  It is loaded the first time the compiler is
+ * checked, and results computed since then are merged back into it by
+ * compiler_check_cache_write_shared.
+ *
+ * Only successful checks are shared.  A failed has_header() or
+ * has_function() usually means a missing package, and installing it does
+ * not change anything in the key.
+ */
+enum {
+	/* entries per compiler, the oldest are dropped first */
+	compiler_check_shared_max_entries = 4096,
+	/* total size of all files, the least recently written are removed first */
+	compiler_check_shared_max_size = 32 * 1024 * 1024,
+};
+
+static bool
+compiler_check_shared_dir(struct workspace *wk, struct sbuf *buf)
+{
+	const char *dir;
+	if (!(dir = getenv("MUON_CACHE_DIR")) || !*dir) {
+		return false;
+	}
+
+	path_join(wk, buf, dir, "compiler_checks");
+	return true;
+}
+
+static bool
+compiler_check_shared_path(struct workspace *wk, obj comp_id, struct sbuf *buf)
+{
+	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
+
+	SBUF(dir);
+	if (!compiler_check_shared_dir(wk, &dir)) {
+		return false;
+	}
+
+	SBUF(id);
+	uint32_t i;
+	for (i = 0; i < get_obj_array(wk, comp->cmd_arr)->len; ++i) {
+		obj v;
+		obj_array_index(wk, comp->cmd_arr, i, &v);
+		sbuf_pushf(wk, &id, "%s\n", get_cstr(wk, v));
+
+		SBUF(cmd);
+		struct stat sb;
+		if (fs_find_cmd(wk, &cmd, get_cstr(wk, v)) && fs_stat(cmd.buf, &sb)) {
+			sbuf_pushf(wk, &id, "%s\n%" PRIu64 "\n%" PRIu64 "\n",
+				cmd.buf, (uint64_t)sb.st_size, (uint64_t)sb.st_mtime);
+		}
+	}
+
+	if (comp->ver) {
+		sbuf_pushf(wk, &id, "%s\n", get_cstr(wk, comp->ver));
+	}
+
+	static const char *env_vars[] = {
+		"CPATH", "C_INCLUDE_PATH", "CPLUS_INCLUDE_PATH", "OBJC_INCLUDE_PATH",
+		"LIBRARY_PATH", "LD_LIBRARY_PATH", "COMPILER_PATH", "GCC_EXEC_PREFIX",
+		"SDKROOT",
+	};
+
+	for (i = 0; i < ARRAY_LEN(env_vars); ++i) {
+		const char *v;
+		if ((v = getenv(env_vars[i]))) {
+			sbuf_pushf(wk, &id, "%s=%s\n", env_vars[i], v);
+		}
+	}
+
+	uint8_t sha[32];
+	calc_sha_256(sha, id.buf, id.len);
+
+	char name[32 + 5];
+	for (i = 0; i < 16; ++i) {
+		snprintf(&name[i * 2], 3, "%02x", sha[i]);
+	}
+	strcpy(&name[32], ".dat");
+
+	path_join(wk, buf, dir.buf, name);
+	return true;
+}
+
 static bool
-compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
-	const char *argstr, uint32_t argc, const char *src,
+compiler_check_shared_read(struct workspace *wk, const char *path, obj *res)
+{
+	FILE *f;
+	bool ok;
+
+	if (!(f = fs_fopen(path, "rb"))) {
+		return false;
+	}
+
+	if (!(ok = serial_load(wk, res, f))) {
+		LOG_W("ignoring invalid compiler check cache %s", path);
+	}
+
+	return fs_fclose(f) && ok;
+}
+
+static bool
+compiler_check_shared_result_ok(struct workspace *wk, obj val)
+{
+	obj res;
+	obj_array_index(wk, val, 0, &res);
+	return get_obj_bool(wk, res);
+}
+
+static enum iteration_result
+compiler_check_shared_merge_iter(struct workspace *wk, void *_ctx, obj key, obj val)
+{
+	if (compiler_check_shared_result_ok(wk, val)
+	    && !obj_dict_in(wk, wk->compiler_check_cache, key)) {
+		obj_dict_set(wk, wk->compiler_check_cache, key, val);
+	}
+
+	return ir_cont;
+}
+
+/*
+ * wk->compiler_check_shared maps a compiler to an empty array if sharing is
+ * disabled, or [path, keys of results not yet in the shared cache].
+ */
+static obj
+compiler_check_shared_load(struct workspace *wk, obj comp_id)
+{
+	obj entry;
+	if (obj_dict_geti(wk, wk->compiler_check_shared, comp_id, &entry)) {
+		return entry;
+	}
+
+	make_obj(wk, &entry, obj_array);
+	obj_dict_seti(wk, wk->compiler_check_shared, comp_id, entry);
+
+	SBUF(path);
+	if (!compiler_check_shared_path(wk, comp_id, &path)) {
+		return entry;
+	}
+
+	obj new_keys;
+	make_obj(wk, &new_keys, obj_array);
+	obj_array_push(wk, entry, make_str(wk, path.buf));
+	obj_array_push(wk, entry, new_keys);
+
+	obj cache;
+	if (fs_file_exists(path.buf) && compiler_check_shared_read(wk, path.buf, &cache)) {
+		obj_dict_foreach(wk, cache, NULL, compiler_check_shared_merge_iter);
+	}
+
+	return entry;
+}
+
+struct compiler_check_shared_trim_ctx {
+	obj cache;
+	uint32_t drop;
+};
+
+static enum iteration_result
+compiler_check_shared_add_iter(struct workspace *wk, void *_ctx, obj key)
+{
+	obj cache = *(obj *)_ctx, val;
+
+	if (obj_dict_index(wk, wk->compiler_check_cache, key, &val)
+	    && compiler_check_shared_result_ok(wk, val)) {
+		obj_dict_set(wk, cache, key, val);
+	}
+
+	return ir_cont;
+}
+
+static enum iteration_result
+compiler_check_shared_trim_iter(struct workspace *wk, void *_ctx, obj key, obj val)
+{
+	struct compiler_check_shared_trim_ctx *ctx = _ctx;
+
+	if (ctx->drop) {
+		--ctx->drop;
+	} else {
+		obj_dict_set(wk, ctx->cache, key, val);
+	}
+
+	return ir_cont;
+}
+
+static bool
+compiler_check_shared_write(struct workspace *wk, const char *path, obj new_keys)
+{
+	obj cache;
+	if (!fs_file_exists(path) || !compiler_check_shared_read(wk, path, &cache)) {
+		make_obj(wk, &cache, obj_dict);
+	}
+
+	obj_array_foreach(wk, new_keys, &cache, compiler_check_shared_add_iter);
+
+	uint32_t len = get_obj_dict(wk, cache)->len;
+	if (len > compiler_check_shared_max_entries) {
+		struct compiler_check_shared_trim_ctx ctx = {
+			.drop = len - compiler_check_shared_max_entries,
+		};
+		make_obj(wk, &ctx.cache, obj_dict);
+		obj_dict_foreach(wk, cache, &ctx, compiler_check_shared_trim_iter);
+		cache = ctx.cache;
+	}
+
+	SBUF(tmp_path);
+	sbuf_pushf(wk, &tmp_path, "%s.tmp", path);
+
+	FILE *f;
+	if (!(f = fs_fopen(tmp_path.buf, "wb"))) {
+		return false;
+	} else if (!serial_dump(wk, cache, f)) {
+		fs_fclose(f);
+		return false;
+	} else if (!fs_fclose(f)) {
+		return false;
+	}
+
+	return fs_rename(tmp_path.buf, path);
+}
+
+struct compiler_check_shared_file {
+	obj path;
+	uint64_t size;
+	int64_t mtime;
+};
+
+struct compiler_check_shared_evict_ctx {
+	struct workspace *wk;
+	const char *dir;
+	struct darr files;
+	uint64_t size;
+};
+
+static enum iteration_result
+compiler_check_shared_evict_iter(void *_ctx, const char *name)
+{
+	struct compiler_check_shared_evict_ctx *ctx = _ctx;
+	uint32_t len = strlen(name);
+
+	if (len < 4 || strcmp(&name[len - 4], ".dat") != 0) {
+		return ir_cont;
+	}
+
+	SBUF(path);
+	path_join(ctx->wk, &path, ctx->dir, name);
+
+	struct stat sb;
+	if (fs_stat(path.buf, &sb)) {
+		struct compiler_check_shared_file file = {
+			.path = make_str(ctx->wk, path.buf),
+			.size = sb.st_size,
+			.mtime = sb.st_mtime,
+		};
+		darr_push(&ctx->files, &file);
+		ctx->size += file.size;
+	}
+
+	return ir_cont;
+}
+
+static int32_t
+compiler_check_shared_file_cmp(const void *_a, const void *_b, void *_ctx)
+{
+	const struct compiler_check_shared_file *a = _a, *b = _b;
+	return a->mtime < b->mtime ? -1 : (a->mtime > b->mtime ? 1 : 0);
+}
+
+static void
+compiler_check_shared_evict(struct workspace *wk, const char *dir)
+{
+	struct compiler_check_shared_evict_ctx ctx = { .wk = wk, .dir = dir };
+	darr_init(&ctx.files, 64, sizeof(struct compiler_check_shared_file));
+
+	if (fs_dir_foreach(dir, &ctx, compiler_check_shared_evict_iter)) {
+		darr_sort(&ctx.files, NULL, compiler_check_shared_file_cmp);
+
+		uint32_t i;
+		for (i = 0; i < ctx.files.len && ctx.size > compiler_check_shared_max_size; ++i) {
+			struct compiler_check_shared_file *file = darr_get(&ctx.files, i);
+			L("removing %s from the compiler check cache", get_cstr(wk, file->path));
+			fs_remove(get_cstr(wk, file->path));
+			ctx.size -= file->size;
+		}
+	}
+
+	darr_destroy(&ctx.files);
+}
+
+struct compiler_check_shared_lock {
+	FILE *f;
+	obj dir;
+};
+
+static enum iteration_result
+compiler_check_cache_write_shared_iter(struct workspace *wk, void *_ctx, obj _comp_id, obj entry)
+{
+	struct compiler_check_shared_lock *lock = _ctx;
+	obj path, new_keys;
+
+	if (!get_obj_array(wk, entry)->len) {
+		return ir_cont;
+	}
+
+	obj_array_index(wk, entry, 0, &path);
+	obj_array_index(wk, entry, 1, &new_keys);
+	if (!get_obj_array(wk, new_keys)->len) {
+		return ir_cont;
+	}
+
+	if (!lock->f) {
+		SBUF(dir);
+		path_dirname(wk, &dir, get_cstr(wk, path));
+		if (!fs_mkdir_p(dir.buf)) {
+			return ir_done;
+		}
+
+		SBUF(lock_path);
+		path_join(wk, &lock_path, dir.buf, "lock");
+		if (!(lock->f = fs_fopen(lock_path.buf, "ab"))) {
+			return ir_done;
+		} else if (!fs_lock(lock->f)) {
+			fs_fclose(lock->f);
+			lock->f = NULL;
+			return ir_done;
+		}
+
+		lock->dir = sbuf_into_str(wk, &dir);
+	}
+
+	if (!compiler_check_shared_write(wk, get_cstr(wk, path), new_keys)) {
+		LOG_W("failed to update compiler check cache %s", get_cstr(wk, path));
+	}
+
+	return ir_cont;
+}
+
+void
+compiler_check_cache_write_shared(struct workspace *wk)
+{
+	struct compiler_check_shared_lock lock = { 0 };
+
+	obj_dict_foreach(wk, wk->compiler_check_shared, &lock, compiler_check_cache_write_shared_iter);
+
+	if (lock.f) {
+		compiler_check_shared_evict(wk, get_cstr(wk, lock.dir));
+		fs_fclose(lock.f);
+	}
+}
+
+static bool
+compiler_check_cache(struct workspace *wk, obj comp_id,
+	const char *argstr, uint32_t argc, const char *src, bool src_is_path,
 	uint8_t sha_res[32], bool *res, obj *res_val)
 {
-	uint32_t argstr_len;
+	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
+	obj shared = compiler_check_shared_load(wk, comp_id);
+
+	/* Paths into muon_private are replaced so that results may be shared
+	 * between build directories.
+	 */
+	SBUF(args);
 	{
-		uint32_t i = 0;
-		const char *p = argstr;
-		for (;; ++p) {
-			if (!p[0]) {
-				if (++i >= argc) {
-					break;
-				}
+		uint32_t i, private_len = wk->muon_private ? strlen(wk->muon_private) : 0;
+		const char *p = argstr, *m;
+		for (i = 0; i < argc; ++i) {
+			while (private_len && (m = strstr(p, wk->muon_private))) {
+				sbuf_pushn(wk, &args, p, m - p);
+				sbuf_pushs(wk, &args, "@private@");
+				p = m + private_len;
 			}
-		}
 
-		argstr_len = p - argstr;
+			sbuf_pushn(wk, &args, p, strlen(p) + 1);
+			p += strlen(p) + 1;
+		}
 	}
 
 	enum {
 		sha_idx_argstr = 0,
 		sha_idx_ver = sha_idx_argstr + 32,
 		sha_idx_src = sha_idx_ver + 32,
-		sha_len = sha_idx_src + 32
+		sha_idx_src_contents = sha_idx_src + 32,
+		sha_len = sha_idx_src_contents + 32
 	};
 
 	uint8_t sha[sha_len] = { 0 };
 
-	calc_sha_256(&sha[sha_idx_argstr], argstr, argstr_len);
+	calc_sha_256(&sha[sha_idx_argstr], args.buf, args.len);
 
 	if (comp->ver) {
 		const struct str *ver = get_str(wk, comp->ver);
@@ -163,6 +526,17 @@ compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
 
 	calc_sha_256(&sha[sha_idx_src], src, strlen(src));
 
+	/* Checks of a file are keyed by its contents as well, so that editing
+	 * the file is not answered from this or the shared cache.
+	 */
+	if (src_is_path) {
+		struct source src_file = { 0 };
+		if (fs_file_exists(src) && fs_read_entire_file(src, &src_file)) {
+			calc_sha_256(&sha[sha_idx_src_contents], src_file.src, src_file.len);
+			fs_source_destroy(&src_file);
+		}
+	}
+
 	calc_sha_256(sha_res, sha, sha_len);
 
 	/* LLOG_I("sha: "); */
@@ -181,6 +555,11 @@ compiler_check_cache(struct workspace *wk, struct obj_compiler *comp,
 		obj_array_index(wk, arr, 1, res_val);
 		return true;
 	} else {
+		obj new_keys;
+		if (get_obj_array(wk, shared)->len) {
+			obj_array_index(wk, shared, 1, &new_keys);
+			obj_array_push(wk, new_keys, make_strn(wk, (const char *)sha_res, 32));
+		}
 		return false;
 	}
 }
@@ -210,22 +589,28 @@ set_compiler_cache(struct workspace *wk, obj key, bool res, obj val)
 	}
 }
 
-static bool
-compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
-	const char *src, uint32_t err_node, bool *res)
+static const char *
+compiler_check_output_path(struct workspace *wk, struct compiler_check_opts *opts, struct sbuf *buf)
 {
-	enum requirement_type req = requirement_auto;
-	if (opts->required && opts->required->set) {
-		if (!coerce_requirement(wk, opts->required, &req)) {
-			return false;
-		}
-	}
+	struct obj_compiler *comp = get_obj_compiler(wk, opts->comp_id);
 
-	if (req == requirement_skip) {
-		*res = false;
-		return true;
+	if (opts->output_path) {
+		return opts->output_path;
+	} else if (opts->mode == compile_mode_run) {
+		path_join(wk, buf, wk->muon_private, "compiler_check_exe");
+	} else {
+		path_join(wk, buf, wk->muon_private, "test.");
+		sbuf_pushs(wk, buf, compiler_language_extension(comp->lang));
+		sbuf_pushs(wk, buf, compilers[comp->type].object_ext);
 	}
 
+	return buf->buf;
+}
+
+static bool
+compiler_check_args(struct workspace *wk, struct compiler_check_opts *opts,
+	const char *src, const char *output_path, obj *res, obj *source_path)
+{
 	struct obj_compiler *comp = get_obj_compiler(wk, opts->comp_id);
 	enum compiler_type t = comp->type;
 
@@ -278,31 +663,16 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 		break;
 	}
 
-	obj source_path;
 	if (opts->src_is_path) {
-		source_path = make_str(wk, src);
+		*source_path = make_str(wk, src);
 	} else {
 		SBUF(test_source_path);
 		path_join(wk, &test_source_path, wk->muon_private, "test.");
 		sbuf_pushs(wk, &test_source_path, compiler_language_extension(comp->lang));
-		source_path = sbuf_into_str(wk, &test_source_path);
+		*source_path = sbuf_into_str(wk, &test_source_path);
 	}
 
-	obj_array_push(wk, compiler_args, source_path);
-
-	SBUF(test_output_path);
-	const char *output_path;
-	if (opts->output_path) {
-		output_path = opts->output_path;
-	} else if (opts->mode == compile_mode_run) {
-		path_join(wk, &test_output_path, wk->muon_private, "compiler_check_exe");
-		output_path = test_output_path.buf;
-	} else {
-		path_join(wk, &test_output_path, wk->muon_private, "test.");
-		sbuf_pushs(wk, &test_output_path, compiler_language_extension(comp->lang));
-		sbuf_pushs(wk, &test_output_path, compilers[t].object_ext);
-		output_path = test_output_path.buf;
-	}
+	obj_array_push(wk, compiler_args, *source_path);
 
 	push_args(wk, compiler_args, compilers[t].args.output(output_path));
 
@@ -321,6 +691,41 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 		obj_array_extend(wk, compiler_args, opts->args);
 	}
 
+	*res = compiler_args;
+	return true;
+}
+
+/*
+ * dict[sha_256 -> bool] of results computed ahead of time by
+ * compiler_check_prefetch_arguments(), only set while a prefetched batch
+ * is being consumed.
+ */
+static obj compiler_check_prefetched;
+
+static bool
+compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
+	const char *src, uint32_t err_node, bool *res)
+{
+	enum requirement_type req = requirement_auto;
+	if (opts->required && opts->required->set) {
+		if (!coerce_requirement(wk, opts->required, &req)) {
+			return false;
+		}
+	}
+
+	if (req == requirement_skip) {
+		*res = false;
+		return true;
+	}
+
+	SBUF(test_output_path);
+	const char *output_path = compiler_check_output_path(wk, opts, &test_output_path);
+
+	obj compiler_args, source_path;
+	if (!compiler_check_args(wk, opts, src, output_path, &compiler_args, &source_path)) {
+		return false;
+	}
+
 	bool ret = false;
 	struct run_cmd_ctx cmd_ctx = { 0 };
 
@@ -329,13 +734,20 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 	join_args_argstr(wk, &argstr, &argc, compiler_args);
 
 	uint8_t sha[32];
-	if (compiler_check_cache(wk, comp, argstr, argc, src, sha, res, &opts->cache_val)) {
+	if (compiler_check_cache(wk, opts->comp_id, argstr, argc, src, opts->src_is_path, sha, res, &opts->cache_val)) {
 		opts->from_cache = true;
 		return true;
 	}
 
 	opts->cache_key = make_strn(wk, (const char *)sha, 32);
 
+	obj prefetched;
+	if (compiler_check_prefetched
+	    && obj_dict_index(wk, compiler_check_prefetched, opts->cache_key, &prefetched)) {
+		*res = get_obj_bool(wk, prefetched);
+		goto have_res;
+	}
+
 	if (!opts->src_is_path) {
 		if (!fs_write(get_cstr(wk, source_path), (const uint8_t *)src, strlen(src))) {
 			return false;
@@ -379,6 +791,7 @@ compiler_check(struct workspace *wk, struct compiler_check_opts *opts,
 		*res = cmd_ctx.status == 0;
 	}
 
+have_res:
 	set_compiler_cache(wk, opts->cache_key, *res, 0);
 
 	ret = true;
@@ -1220,7 +1633,7 @@ compiler_get_define(struct workspace *wk, uint32_t err_node,
 		}
 
 		if (started) {
-			str_appn(wk, *res, &output.src[i], 1);
+			str_appn(wk, res, &output.src[i], 1);
 		}
 	}
 
@@ -1647,20 +2060,40 @@ func_compiler_run(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 
 	if (ok) {
 		rr->flags |= run_result_flag_compile_ok;
-		rr->out = make_strn(wk, opts.cmd_ctx.out.buf, opts.cmd_ctx.out.len);
-		rr->err = make_strn(wk, opts.cmd_ctx.err.buf, opts.cmd_ctx.err.len);
-		rr->status = opts.cmd_ctx.status;
+
+		/* cached as [stdout, stderr, status] */
+		obj cache_val, status;
+		if (opts.from_cache && opts.cache_val) {
+			obj_array_index(wk, opts.cache_val, 0, &rr->out);
+			obj_array_index(wk, opts.cache_val, 1, &rr->err);
+			obj_array_index(wk, opts.cache_val, 2, &status);
+			rr->status = get_obj_number(wk, status);
+		} else {
+			rr->out = make_strn(wk, opts.cmd_ctx.out.buf, opts.cmd_ctx.out.len);
+			rr->err = make_strn(wk, opts.cmd_ctx.err.buf, opts.cmd_ctx.err.len);
+			rr->status = opts.cmd_ctx.status;
+
+			make_obj(wk, &status, obj_number);
+			set_obj_number(wk, status, rr->status);
+
+			make_obj(wk, &cache_val, obj_array);
+			obj_array_push(wk, cache_val, rr->out);
+			obj_array_push(wk, cache_val, rr->err);
+			obj_array_push(wk, cache_val, status);
+			set_compiler_cache(wk, opts.cache_key, true, cache_val);
+		}
 	}
 
 	run_cmd_ctx_destroy(&opts.cmd_ctx);
 	return true;
 }
 
-static bool
-compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_argument, enum compile_mode mode)
+static const char *compiler_has_argument_src = "int main(void){}\n";
+
+static obj
+compiler_has_argument_args(struct workspace *wk, obj comp_id, obj arg)
 {
 	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
-	enum compiler_type t = comp->type;
 
 	obj args;
 	make_obj(wk, &args, obj_array);
@@ -1668,22 +2101,28 @@ compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj
 		obj_array_push(wk, args, arg);
 	} else {
 		obj_array_extend(wk, args, arg);
-
-		obj str;
-		obj_array_join(wk, true, arg, make_str(wk, " "), &str);
-		arg = str;
 	}
 
-	push_args(wk, args, compilers[t].args.werror());
+	push_args(wk, args, compilers[comp->type].args.werror());
+	return args;
+}
 
+static bool
+compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj arg, bool *has_argument, enum compile_mode mode)
+{
 	struct compiler_check_opts opts = {
 		.mode = mode,
 		.comp_id = comp_id,
-		.args = args,
+		.args = compiler_has_argument_args(wk, comp_id, arg),
 	};
 
-	const char *src = "int main(void){}\n";
-	if (!compiler_check(wk, &opts, src, err_node, has_argument)) {
+	if (get_obj_type(wk, arg) != obj_string) {
+		obj str;
+		obj_array_join(wk, true, arg, make_str(wk, " "), &str);
+		arg = str;
+	}
+
+	if (!compiler_check(wk, &opts, compiler_has_argument_src, err_node, has_argument)) {
 		return false;
 	}
 
@@ -1696,6 +2135,177 @@ compiler_has_argument(struct workspace *wk, obj comp_id, uint32_t err_node, obj
 	return true;
 }
 
+/*
+ * Argument checks in a get_supported_arguments() style call don't depend on
+ * each other, so they are started up front, up to wk->compiler_check_jobs
+ * at a time.  Each job writes to its own output file, but its result is
+ * keyed by the arguments it would have had when run by compiler_check().
+ * The caller then runs the checks in order as usual, which picks up these
+ * results, so logging and the compiler check cache are unaffected.
+ */
+struct compiler_check_job {
+	struct run_cmd_ctx cmd_ctx;
+	obj cache_key;
+	bool busy;
+};
+
+static void
+compiler_check_job_start(struct workspace *wk, struct compiler_check_job *job,
+	uint32_t job_id, obj comp_id, obj arg, enum compile_mode mode, bool *wrote_src)
+{
+	struct obj_compiler *comp = get_obj_compiler(wk, comp_id);
+	struct compiler_check_opts opts = {
+		.mode = mode,
+		.comp_id = comp_id,
+		.args = compiler_has_argument_args(wk, comp_id, arg),
+	};
+
+	obj compiler_args, source_path;
+	const char *argstr;
+	uint32_t argc;
+
+	{
+		SBUF(output_path);
+		if (!compiler_check_args(wk, &opts, compiler_has_argument_src,
+			compiler_check_output_path(wk, &opts, &output_path),
+			&compiler_args, &source_path)) {
+			return;
+		}
+	}
+
+	join_args_argstr(wk, &argstr, &argc, compiler_args);
+
+	uint8_t sha[32];
+	bool cached_res;
+	obj cached_val;
+	if (compiler_check_cache(wk, comp_id, argstr, argc, compiler_has_argument_src, false,
+		sha, &cached_res, &cached_val)) {
+		return;
+	}
+
+	if (!*wrote_src) {
+		if (!fs_write(get_cstr(wk, source_path), (const uint8_t *)compiler_has_argument_src,
+			strlen(compiler_has_argument_src))) {
+			return;
+		}
+		*wrote_src = true;
+	}
+
+	SBUF(output_path);
+	path_join(wk, &output_path, wk->muon_private, "test_job");
+	sbuf_pushf(wk, &output_path, "%d.", job_id);
+	sbuf_pushs(wk, &output_path, compiler_language_extension(comp->lang));
+	sbuf_pushs(wk, &output_path, compilers[comp->type].object_ext);
+
+	if (!compiler_check_args(wk, &opts, compiler_has_argument_src, output_path.buf,
+		&compiler_args, &source_path)) {
+		return;
+	}
+
+	join_args_argstr(wk, &argstr, &argc, compiler_args);
+
+	*job = (struct compiler_check_job) {
+		.cmd_ctx = { .flags = run_cmd_ctx_flag_async },
+		.cache_key = make_strn(wk, (const char *)sha, 32),
+	};
+
+	if (!run_cmd(&job->cmd_ctx, argstr, argc, NULL, 0)) {
+		run_cmd_ctx_destroy(&job->cmd_ctx);
+		return;
+	}
+
+	job->busy = true;
+}
+
+static bool
+compiler_check_job_collect(struct workspace *wk, struct compiler_check_job *job)
+{
+	switch (run_cmd_collect(&job->cmd_ctx)) {
+	case run_cmd_running:
+		return false;
+	case run_cmd_finished: {
+		obj res;
+		make_obj(wk, &res, obj_bool);
+		set_obj_bool(wk, res, job->cmd_ctx.status == 0);
+		obj_dict_set(wk, compiler_check_prefetched, job->cache_key, res);
+		break;
+	}
+	case run_cmd_error:
+		// leave it to be reported when it is run again in order
+		break;
+	}
+
+	run_cmd_ctx_destroy(&job->cmd_ctx);
+	job->busy = false;
+	return true;
+}
+
+static enum iteration_result
+compiler_check_prefetch_flatten_iter(struct workspace *wk, void *_ctx, obj val)
+{
+	obj_array_push(wk, *(obj *)_ctx, val);
+	return ir_cont;
+}
+
+static void
+compiler_check_prefetch_arguments(struct workspace *wk, obj comp_id, obj list, enum compile_mode mode)
+{
+	obj args;
+	make_obj(wk, &args, obj_array);
+	obj_array_foreach_flat(wk, list, &args, compiler_check_prefetch_flatten_iter);
+
+	uint32_t i, j, len = get_obj_array(wk, args)->len, busy = 0, jobs = wk->compiler_check_jobs;
+	if (jobs < 2 || len < 2) {
+		return;
+	}
+
+	make_obj(wk, &compiler_check_prefetched, obj_dict);
+
+	struct compiler_check_job *job = z_calloc(jobs, sizeof(struct compiler_check_job));
+	struct run_cmd_ctx **cmd_ctxs = z_calloc(jobs, sizeof(struct run_cmd_ctx *));
+	bool wrote_src = false, collected;
+
+	i = 0;
+	while (i < len || busy) {
+		for (j = 0; j < jobs && i < len; ++j) {
+			if (job[j].busy) {
+				continue;
+			}
+
+			obj arg;
+			obj_array_index(wk, args, i, &arg);
+			++i;
+
+			compiler_check_job_start(wk, &job[j], j, comp_id, arg, mode, &wrote_src);
+			if (job[j].busy) {
+				++busy;
+			}
+		}
+
+		collected = false;
+		for (j = 0; j < jobs; ++j) {
+			if (job[j].busy && compiler_check_job_collect(wk, &job[j])) {
+				--busy;
+				collected = true;
+			}
+		}
+
+		if (busy && !collected) {
+			uint32_t n = 0;
+			for (j = 0; j < jobs; ++j) {
+				if (job[j].busy) {
+					cmd_ctxs[n++] = &job[j].cmd_ctx;
+				}
+			}
+
+			run_cmd_wait(cmd_ctxs, n, 1000);
+		}
+	}
+
+	z_free(job);
+	z_free(cmd_ctxs);
+}
+
 struct func_compiler_get_supported_arguments_iter_ctx {
 	uint32_t node;
 	obj arr, compiler;
@@ -1772,13 +2382,18 @@ compiler_get_supported_arguments(struct workspace *wk, obj rcvr, uint32_t args_n
 
 	make_obj(wk, res, obj_array);
 
-	return obj_array_foreach_flat(wk, an[0].val,
+	compiler_check_prefetch_arguments(wk, rcvr, an[0].val, mode);
+
+	bool ret = obj_array_foreach_flat(wk, an[0].val,
 		&(struct func_compiler_get_supported_arguments_iter_ctx) {
 		.compiler = rcvr,
 		.arr = *res,
 		.node = an[0].node,
 		.mode = mode,
 	}, func_compiler_get_supported_arguments_iter);
+
+	compiler_check_prefetched = 0;
+	return ret;
 }
 
 static bool
@@ -1823,13 +2438,18 @@ compiler_first_supported_argument(struct workspace *wk, obj rcvr, uint32_t args_
 
 	make_obj(wk, res, obj_array);
 
-	return obj_array_foreach_flat(wk, an[0].val,
+	compiler_check_prefetch_arguments(wk, rcvr, an[0].val, mode);
+
+	bool ret = obj_array_foreach_flat(wk, an[0].val,
 		&(struct func_compiler_get_supported_arguments_iter_ctx) {
 		.compiler = rcvr,
 		.arr = *res,
 		.node = an[0].node,
 		.mode = mode,
 	}, func_compiler_first_supported_argument_iter);
+
+	compiler_check_prefetched = 0;
+	return ret;
 }
 
 static bool
@@ -11,6 +11,7 @@
 #include "args.h"
 #include "buf_size.h"
 #include "coerce.h"
+#include "dir_cache.h"
 #include "error.h"
 #include "external/samurai.h"
 #include "functions/common.h"
@@ -554,7 +555,10 @@ find_program_check_fallback(struct workspace *wk, struct find_program_iter_ctx *
 {
 	obj fallback_arr, subproj_name;
 	if (obj_dict_index(wk, current_project(wk)->wrap_provides_exes, prog, &fallback_arr)) {
-		obj_array_flatten_one(wk, fallback_arr, &subproj_name);
+		if (!obj_array_flatten_one(wk, fallback_arr, &subproj_name)) {
+			interp_error(wk, ctx->node, "expected exactly one subproject to provide %o, got %o", prog, fallback_arr);
+			return false;
+		}
 
 		obj subproj;
 		if (!subproject(wk, subproj_name, requirement_auto, NULL, NULL, &subproj)
@@ -1048,6 +1052,9 @@ func_run_command(struct workspace *wk, obj _, uint32_t args_node, obj *res)
 	bool ret = false;
 	struct run_cmd_ctx cmd_ctx = { 0 };
 
+	/* the command may create or remove files in the source tree */
+	dir_cache_clear(wk);
+
 	if (!run_cmd(&cmd_ctx, argstr, argc, envstr, envc)) {
 		interp_error(wk, an[0].node, "%s", cmd_ctx.err_msg);
 		goto ret;
@@ -5,6 +5,7 @@
 
 #include "compat.h"
 
+#include "dir_cache.h"
 #include "functions/kernel/subproject.h"
 #include "functions/string.h"
 #include "lang/interpreter.h"
@@ -34,7 +35,9 @@ subproject_prepare(struct workspace *wk, struct sbuf *cwd_buf, const char **cwd,
 
 		struct wrap wrap = { 0 };
 		enum wrap_mode wrap_mode = get_option_wrap_mode(wk);
-		if (!wrap_handle(wrap_path.buf, base_path.buf, &wrap, wrap_mode != wrap_mode_nodownload)) {
+		bool handled = wrap_handle(wrap_path.buf, base_path.buf, &wrap, wrap_mode != wrap_mode_nodownload);
+		dir_cache_clear(wk);
+		if (!handled) {
 			goto wrap_cleanup;
 		}
 
@@ -9,6 +9,7 @@
 #include <string.h>
 
 #include "args.h"
+#include "dir_cache.h"
 #include "functions/common.h"
 #include "functions/kernel/custom_target.h"
 #include "functions/modules/fs.h"
@@ -76,7 +77,7 @@ fix_file_path(struct workspace *wk, uint32_t err_node, obj path, enum fix_file_p
 	return true;
 }
 
-typedef bool ((*fs_lookup_func)(const char *));
+typedef bool ((*fs_lookup_func)(struct workspace *wk, const char *));
 
 static bool
 func_module_fs_lookup_common(struct workspace *wk, uint32_t args_node, obj *res, fs_lookup_func lookup, enum fix_file_path_opts opts)
@@ -92,32 +93,39 @@ func_module_fs_lookup_common(struct workspace *wk, uint32_t args_node, obj *res,
 	}
 
 	make_obj(wk, res, obj_bool);
-	set_obj_bool(wk, *res, lookup(path.buf));
+	set_obj_bool(wk, *res, lookup(wk, path.buf));
+	dir_cache_add_regenerate_dep(wk, path.buf);
 	return true;
 }
 
 static bool
 func_module_fs_exists(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
-	return func_module_fs_lookup_common(wk, args_node, res, fs_exists, fix_file_path_expanduser);
+	return func_module_fs_lookup_common(wk, args_node, res, dir_cache_exists, fix_file_path_expanduser);
 }
 
 static bool
 func_module_fs_is_file(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
-	return func_module_fs_lookup_common(wk, args_node, res, fs_file_exists, fix_file_path_expanduser);
+	return func_module_fs_lookup_common(wk, args_node, res, dir_cache_file_exists, fix_file_path_expanduser);
 }
 
 static bool
 func_module_fs_is_dir(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
-	return func_module_fs_lookup_common(wk, args_node, res, fs_dir_exists, fix_file_path_expanduser);
+	return func_module_fs_lookup_common(wk, args_node, res, dir_cache_dir_exists, fix_file_path_expanduser);
+}
+
+static bool
+symlink_exists(struct workspace *wk, const char *path)
+{
+	return fs_symlink_exists(path);
 }
 
 static bool
 func_module_fs_is_symlink(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res)
 {
-	return func_module_fs_lookup_common(wk, args_node, res, fs_symlink_exists,
+	return func_module_fs_lookup_common(wk, args_node, res, symlink_exists,
 		fix_file_path_allow_file | fix_file_path_expanduser);
 }
 
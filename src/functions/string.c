@@ -94,7 +94,7 @@ string_format(struct workspace *wk, uint32_t err_node, obj str, obj *res, void *
 				id_end = i + 1;
 
 				if (i == id_start) {
-					str_app(wk, *res, "@");
+					str_app(wk, res, "@");
 					id_start = i + 1;
 					reading_id = true;
 					key.len = 0;
@@ -117,11 +117,11 @@ string_format(struct workspace *wk, uint32_t err_node, obj str, obj *res, void *
 					}
 
 					const struct str *ss = get_str(wk, coerced);
-					str_appn(wk, *res, ss->s, ss->len);
+					str_appn(wk, res, ss->s, ss->len);
 					break;
 				}
 				case format_cb_skip: {
-					str_app(wk, *res, "@");
+					str_app(wk, res, "@");
 					i = id_start - 1;
 					id_end = id_start;
 					id_start = 0;
@@ -133,7 +133,7 @@ string_format(struct workspace *wk, uint32_t err_node, obj str, obj *res, void *
 				reading_id = false;
 			} else {
 				if (i) {
-					str_appn(wk, *res, &ss_in->s[id_end], i - id_end);
+					str_appn(wk, res, &ss_in->s[id_end], i - id_end);
 				}
 
 				id_start = i + 1;
@@ -144,11 +144,11 @@ string_format(struct workspace *wk, uint32_t err_node, obj str, obj *res, void *
 	}
 
 	if (reading_id) {
-		str_app(wk, *res, "@");
-		str_appn(wk, *res, &ss_in->s[id_start], i - id_start);
+		str_app(wk, res, "@");
+		str_appn(wk, res, &ss_in->s[id_start], i - id_start);
 	} else {
 		if (i > id_end) {
-			str_appn(wk, *res, &ss_in->s[id_end], i - id_end);
+			str_appn(wk, res, &ss_in->s[id_end], i - id_end);
 		}
 	}
 
@@ -468,8 +468,8 @@ func_string_replace(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res
 		};
 
 		if (str_startswith(&tmp, find)) {
-			str_appn(wk, *res, pre.s, pre.len);
-			str_appn(wk, *res, replace->s, replace->len);
+			str_appn(wk, res, pre.s, pre.len);
+			str_appn(wk, res, replace->s, replace->len);
 			i += find->len;
 			pre.s = &s->s[i];
 			pre.len = 0;
@@ -480,7 +480,7 @@ func_string_replace(struct workspace *wk, obj rcvr, uint32_t args_node, obj *res
 		}
 	}
 
-	str_appn(wk, *res, pre.s, pre.len);
+	str_appn(wk, res, pre.s, pre.len);
 
 	return true;
 }
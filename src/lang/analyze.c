@@ -277,7 +277,7 @@ analyze_unassign(struct workspace *wk, const char *name)
 
 	darr_del(containing_scope, idx);
 	if (is_base) {
-		hash_unset_str(&current_project(wk)->scope, name);
+		scope_unset(wk, &current_project(wk)->scope, name);
 	}
 }
 
@@ -373,10 +373,10 @@ scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id)
 	}
 
 	// builtin variables don't have a source location
-	struct node *n = NULL;
+	struct node_loc *loc = NULL;
 	uint32_t src_idx = 0, ep_stack_len = 0, ep_stacks_i = 0;
 	if (wk->src && n_id) {
-		n = get_node(wk->ast, n_id);
+		loc = get_node_loc(wk->ast, n_id);
 
 		// push the source so that we have it later for error reporting
 		src_idx = error_diagnostic_store_push_src(wk->src);
@@ -386,22 +386,22 @@ scope_assign(struct workspace *wk, const char *name, obj o, uint32_t n_id)
 	darr_push(s, &(struct assignment) {
 		.name = name,
 		.o = o,
-		.line = n ? n->line : 0,
-		.col = n ? n->col : 0,
+		.line = loc ? loc->line : 0,
+		.col = loc ? loc->col : 0,
 		.src_idx = src_idx,
 		.ep_stacks_i = ep_stacks_i,
 		.ep_stack_len = ep_stack_len,
 	});
 
 	if (!assignment_scopes.groups.len) {
-		struct hash *scope;
+		struct darr *scope;
 		if (wk->projects.len) {
 			scope = &current_project(wk)->scope;
 		} else {
 			scope = &wk->scope;
 		}
 
-		hash_set_str(scope, name, s->len - 1);
+		scope_set(wk, scope, name, s->len - 1);
 	}
 
 	return darr_get(s, s->len - 1);
@@ -596,12 +596,12 @@ analyze_function_call(struct workspace *wk, uint32_t n_id, uint32_t args_node, c
 	analyze_all_function_arguments(wk, n_id, args_node);
 
 	if (subdir_func) {
-		struct node *n = get_node(wk->ast, n_id);
+		struct node_loc *loc = get_node_loc(wk->ast, n_id);
 
 		darr_push(&analyze_entrypoint_stack, &(struct analyze_file_entrypoint) {
 			.src_idx = error_diagnostic_store_push_src(wk->src),
-			.line = n->line,
-			.col = n->col,
+			.line = loc->line,
+			.col = loc->col,
 			.is_root = analyze_entrypoint_stack.len == 0,
 		});
 	}
@@ -1632,11 +1632,13 @@ do_analyze(struct analyze_opts *opts)
 		};
 
 		uint32_t i;
-		uint64_t obj;
+		obj o;
 		for (i = 0; i < ARRAY_LEN(default_vars); ++i) {
-			obj = *hash_get_str(&wk.scope, default_vars[i]);
-			hash_unset_str(&wk.scope, default_vars[i]);
-			struct assignment *a = scope_assign(&wk, default_vars[i], obj, 0);
+			if (!scope_get(&wk, &wk.scope, default_vars[i], &o)) {
+				UNREACHABLE;
+			}
+			scope_unset(&wk, &wk.scope, default_vars[i]);
+			struct assignment *a = scope_assign(&wk, default_vars[i], o, 0);
 			a->default_var = true;
 		}
 	}
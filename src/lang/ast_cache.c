@@ -0,0 +1,451 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <string.h>
+
+#include "backend/output.h"
+#include "lang/ast_cache.h"
+#include "lang/workspace.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/mem.h"
+#include "platform/path.h"
+#include "sha_256.h"
+#include "tracy.h"
+#include "version.h"
+
+/*
+ * Asts parsed after this many nodes are cached are freed after use, as
+ * they were before there was a cache.  Most files are only evaluated once,
+ * so there is no point in holding on to all of them.
+ */
+#define AST_CACHE_MAX_NODES (1u << 18)
+
+static struct ast_cache *
+ast_cache_get(struct workspace *wk)
+{
+	struct ast_cache *ac = &wk->ast_cache;
+
+	if (!ac->init) {
+		hash_init(&ac->keys, 16, 32);
+		bucket_array_init(&ac->asts, 16, sizeof(struct ast));
+		ac->init = true;
+	}
+
+	return ac;
+}
+
+static void
+ast_cache_key(struct source *src, enum parse_mode mode, uint8_t key[32])
+{
+	struct sha_256 sha;
+	uint8_t m = mode;
+
+	sha_256_init(&sha);
+	/* node layout may change between versions */
+	sha_256_write(&sha, muon_version.version, strlen(muon_version.version) + 1);
+	sha_256_write(&sha, muon_version.vcs_tag, strlen(muon_version.vcs_tag) + 1);
+	sha_256_write(&sha, src->label, strlen(src->label) + 1);
+	sha_256_write(&sha, src->src, src->len);
+	sha_256_write(&sha, &m, 1);
+	sha_256_close(&sha, key);
+}
+
+static void
+ast_clear_visited(struct ast *ast)
+{
+	uint32_t i;
+	for (i = 0; i < ast->nodes.len; ++i) {
+		((struct node *)darr_get(&ast->nodes, i))->chflg &= ~node_visited;
+	}
+}
+
+/*
+ * On disk, an ast is stored as:
+ *
+ *   magic and version  8 bytes
+ *   key                32 bytes
+ *   sha256 of the rest 32 bytes
+ *   root, node count and string table length, each a varint
+ *   string table
+ *   nodes
+ *
+ * Each node is its type, child flags, line (relative to the previous
+ * node's), col, and subtype as varints.  Then comes the offset of its
+ * string in the string table for ids and strings, or the value of
+ * numbers.  Then the index of each child present, relative to the node's.
+ * Signed values are zigzag encoded.  Files that don't match this in any
+ * way are ignored and rewritten.  The checksum guards against truncated
+ * or corrupted files, which could otherwise produce a well formed but
+ * nonsensical ast.
+ */
+static const char ast_cache_magic[8] = { 'm', 'u', 'o', 'n', 'a', 's', 't', 1 };
+#define AST_CACHE_HEADER_SIZE (sizeof(ast_cache_magic) + 32 + 32)
+
+static bool
+ast_cache_path(struct workspace *wk, struct source *src, struct sbuf *buf)
+{
+	if (!wk->muon_private) {
+		return false;
+	}
+
+	uint8_t sha[32];
+	calc_sha_256(sha, src->label, strlen(src->label));
+
+	char name[32 + 5];
+	uint32_t i;
+	for (i = 0; i < 16; ++i) {
+		snprintf(&name[i * 2], 3, "%02x", sha[i]);
+	}
+	strcpy(&name[32], ".dat");
+
+	path_join(wk, buf, wk->muon_private, output_path.ast_cache);
+	path_push(wk, buf, name);
+	return true;
+}
+
+static uint8_t *
+put_uvarint(uint8_t *p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	*p++ = v;
+	return p;
+}
+
+static uint8_t *
+put_svarint(uint8_t *p, int64_t v)
+{
+	return put_uvarint(p, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static bool
+node_has_str(const struct node *n)
+{
+	return n->type == node_id || n->type == node_string;
+}
+
+static void
+ast_cache_save(struct workspace *wk, const char *path, const uint8_t key[32], struct ast *ast,
+	const struct source_data *sdata)
+{
+	struct ast_cache *ac = &wk->ast_cache;
+	const struct node *n;
+	uint32_t i, strs_len = 0;
+
+	/* only the strings of ids and string literals are needed, so only the
+	 * part of the lexer's buffer they point into is saved */
+	for (i = 0; i < ast->nodes.len; ++i) {
+		n = darr_get(&ast->nodes, i);
+		if (!node_has_str(n)) {
+			continue;
+		}
+
+		if (n->dat.s < sdata->data || n->dat.s >= sdata->data + sdata->data_len) {
+			return;
+		}
+
+		uint32_t end = (n->dat.s - sdata->data) + (n->type == node_string ? n->subtype : strlen(n->dat.s)) + 1;
+		if (end > strs_len) {
+			strs_len = end;
+		}
+	}
+
+	/* the most a node can take up, with every field a 64 bit varint */
+	const uint32_t max_node_size = 10 * 10;
+
+	SBUF_manual(buf);
+	sbuf_grow(wk, &buf, AST_CACHE_HEADER_SIZE + 3 * 10 + strs_len);
+	uint8_t *p = (uint8_t *)buf.buf;
+	memcpy(p, ast_cache_magic, sizeof(ast_cache_magic));
+	p += sizeof(ast_cache_magic);
+	memcpy(p, key, 32);
+	p += 32 + 32;
+	p = put_uvarint(p, ast->root);
+	p = put_uvarint(p, ast->nodes.len);
+	p = put_uvarint(p, strs_len);
+	memcpy(p, sdata->data, strs_len);
+	p += strs_len;
+
+	int64_t line = 0;
+	for (i = 0; i < ast->nodes.len; ++i) {
+		n = darr_get(&ast->nodes, i);
+		const struct node_loc *loc = darr_get(&ast->locs, i);
+
+		buf.len = p - (uint8_t *)buf.buf;
+		sbuf_grow(wk, &buf, max_node_size);
+		p = (uint8_t *)&buf.buf[buf.len];
+
+		p = put_uvarint(p, n->type);
+		p = put_uvarint(p, n->chflg & (node_child_l | node_child_r | node_child_c | node_child_d));
+		p = put_svarint(p, (int64_t)loc->line - line);
+		line = loc->line;
+		p = put_uvarint(p, loc->col);
+		p = put_uvarint(p, n->subtype);
+
+		if (node_has_str(n)) {
+			p = put_uvarint(p, n->dat.s - sdata->data);
+		} else if (n->type == node_number) {
+			p = put_svarint(p, n->dat.n);
+		}
+
+		if (n->chflg & node_child_l) {
+			p = put_svarint(p, (int64_t)n->l - i);
+		}
+		if (n->chflg & node_child_r) {
+			p = put_svarint(p, (int64_t)n->r - i);
+		}
+		if (n->chflg & node_child_c) {
+			p = put_svarint(p, (int64_t)n->c - i);
+		}
+		if (n->chflg & node_child_d) {
+			p = put_svarint(p, (int64_t)n->d - i);
+		}
+	}
+	buf.len = p - (uint8_t *)buf.buf;
+
+	calc_sha_256((uint8_t *)buf.buf + sizeof(ast_cache_magic) + 32, buf.buf + AST_CACHE_HEADER_SIZE,
+		buf.len - AST_CACHE_HEADER_SIZE);
+
+	if (!ac->dir_created) {
+		SBUF(dir);
+		path_dirname(wk, &dir, path);
+		if (!fs_mkdir_p(dir.buf)) {
+			goto ret;
+		}
+		ac->dir_created = true;
+	}
+
+	SBUF(tmp_path);
+	sbuf_pushf(wk, &tmp_path, "%s.tmp", path);
+
+	if (fs_write(tmp_path.buf, (const uint8_t *)buf.buf, buf.len) && fs_rename(tmp_path.buf, path)) {
+		++ac->stats.saved;
+	}
+ret:
+	sbuf_destroy(&buf);
+}
+
+struct ast_cache_reader {
+	const uint8_t *p, *end;
+	bool ok;
+};
+
+static uint64_t
+read_uvarint(struct ast_cache_reader *r)
+{
+	uint64_t v = 0;
+	uint32_t shift;
+
+	for (shift = 0; shift < 64 && r->p < r->end; shift += 7) {
+		uint8_t b = *r->p++;
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80)) {
+			return v;
+		}
+	}
+
+	r->ok = false;
+	return 0;
+}
+
+static int64_t
+read_svarint(struct ast_cache_reader *r)
+{
+	uint64_t v = read_uvarint(r);
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static bool
+read_child(struct ast_cache_reader *r, uint32_t i, uint32_t len, uint32_t *c)
+{
+	int64_t v = (int64_t)i + read_svarint(r);
+	if (v < 0 || v >= len) {
+		r->ok = false;
+		return false;
+	}
+
+	*c = v;
+	return true;
+}
+
+static bool
+ast_cache_load(struct workspace *wk, const char *path, const uint8_t key[32], struct ast *ast)
+{
+	struct source f = { 0 };
+	struct source_data sdata = { 0 };
+	bool ret = false;
+
+	if (!fs_file_exists(path) || !fs_read_entire_file(path, &f)) {
+		return false;
+	}
+
+	struct ast_cache_reader r = { .p = (const uint8_t *)f.src, .end = (const uint8_t *)f.src + f.len, .ok = true };
+	uint8_t sha[32];
+
+	if (f.len < AST_CACHE_HEADER_SIZE || memcmp(r.p, ast_cache_magic, sizeof(ast_cache_magic)) != 0
+		|| memcmp(r.p + sizeof(ast_cache_magic), key, 32) != 0) {
+		goto ret;
+	}
+
+	calc_sha_256(sha, r.p + AST_CACHE_HEADER_SIZE, f.len - AST_CACHE_HEADER_SIZE);
+	if (memcmp(r.p + sizeof(ast_cache_magic) + 32, sha, 32) != 0) {
+		goto ret;
+	}
+	r.p += AST_CACHE_HEADER_SIZE;
+
+	uint64_t root = read_uvarint(&r), len = read_uvarint(&r), strs_len = read_uvarint(&r);
+	if (!r.ok || !len || root >= len || len > UINT32_MAX || strs_len > (uint64_t)(r.end - r.p)) {
+		goto ret;
+	}
+
+	sdata.data_len = strs_len + 1;
+	sdata.data = z_malloc(sdata.data_len);
+	memcpy(sdata.data, r.p, strs_len);
+	sdata.data[strs_len] = 0;
+	r.p += strs_len;
+
+	darr_init(&ast->nodes, len, sizeof(struct node));
+	darr_init(&ast->locs, len, sizeof(struct node_loc));
+	ast->root = root;
+
+	uint32_t i;
+	int64_t line = 0;
+	for (i = 0; i < len && r.ok; ++i) {
+		struct node n = { 0 };
+		struct node_loc loc;
+		uint64_t v;
+
+		n.type = read_uvarint(&r);
+		n.chflg = read_uvarint(&r);
+		line += read_svarint(&r);
+		loc.line = line;
+		loc.col = read_uvarint(&r);
+		n.subtype = read_uvarint(&r);
+
+		if (n.type > node_plusassign || n.chflg & ~(node_child_l | node_child_r | node_child_c | node_child_d)) {
+			r.ok = false;
+			break;
+		}
+
+		if (node_has_str(&n)) {
+			v = read_uvarint(&r);
+			if (v >= strs_len || (n.type == node_string && n.subtype > strs_len - v)) {
+				r.ok = false;
+				break;
+			}
+			n.dat.s = &sdata.data[v];
+		} else if (n.type == node_number) {
+			n.dat.n = read_svarint(&r);
+		}
+
+		if ((n.chflg & node_child_l) && !read_child(&r, i, len, &n.l)) {
+			break;
+		} else if ((n.chflg & node_child_r) && !read_child(&r, i, len, &n.r)) {
+			break;
+		} else if ((n.chflg & node_child_c) && !read_child(&r, i, len, &n.c)) {
+			break;
+		} else if ((n.chflg & node_child_d) && !read_child(&r, i, len, &n.d)) {
+			break;
+		}
+
+		darr_push(&ast->nodes, &n);
+		darr_push(&ast->locs, &loc);
+	}
+
+	if (!r.ok || r.p != r.end) {
+		ast_destroy(ast);
+		*ast = (struct ast) { 0 };
+		goto ret;
+	}
+
+	for (i = 0; i < len; ++i) {
+		node_init_value(wk, darr_get(&ast->nodes, i));
+	}
+
+	darr_push(&wk->source_data, &sdata);
+	sdata.data = NULL;
+	++wk->ast_cache.stats.loaded;
+	ret = true;
+ret:
+	source_data_destroy(&sdata);
+	fs_source_destroy(&f);
+	return ret;
+}
+
+bool
+ast_cache_parse(struct workspace *wk, struct source *src, enum parse_mode mode, enum ast_cache_flag flags,
+	struct ast *tmp, struct ast **res)
+{
+	TracyCZoneAutoS;
+	struct ast_cache *ac = ast_cache_get(wk);
+	bool ret = false;
+	uint8_t key[32];
+	uint64_t *v;
+
+	*res = tmp;
+
+	ast_cache_key(src, mode, key);
+	if ((v = hash_get(&ac->keys, key))) {
+		++ac->stats.hits;
+		*res = bucket_array_get(&ac->asts, *v);
+		ast_clear_visited(*res);
+		ret = true;
+		goto ret;
+	}
+
+	SBUF(path);
+	bool persist = (flags & ast_cache_flag_persist) && ast_cache_path(wk, src, &path);
+
+	if (!(persist && ast_cache_load(wk, path.buf, key, tmp))) {
+		struct source_data *sdata
+			= darr_get(&wk->source_data, darr_push(&wk->source_data, &(struct source_data) { 0 }));
+
+		if (!parser_parse(wk, tmp, sdata, src, mode)) {
+			goto ret;
+		}
+
+		if (persist && ac->save) {
+			ast_cache_save(wk, path.buf, key, tmp, sdata);
+		}
+	}
+
+	ret = true;
+
+	if (ac->nodes + tmp->nodes.len > AST_CACHE_MAX_NODES) {
+		goto ret;
+	}
+
+	ac->nodes += tmp->nodes.len;
+	hash_set(&ac->keys, key, ac->asts.len);
+	*res = bucket_array_push(&ac->asts, tmp);
+	*tmp = (struct ast) { 0 };
+ret:
+	TracyCZoneAutoE;
+	return ret;
+}
+
+void
+ast_cache_destroy(struct workspace *wk)
+{
+	struct ast_cache *ac = &wk->ast_cache;
+	uint32_t i;
+
+	if (!ac->init) {
+		return;
+	}
+
+	for (i = 0; i < ac->asts.len; ++i) {
+		ast_destroy(bucket_array_get(&ac->asts, i));
+	}
+
+	hash_destroy(&ac->keys);
+	bucket_array_destroy(&ac->asts);
+	ac->init = false;
+}
@@ -11,6 +11,7 @@
 #include "error.h"
 #include "external/bestline.h"
 #include "lang/analyze.h"
+#include "lang/ast_cache.h"
 #include "lang/eval.h"
 #include "lang/interpreter.h"
 #include "lang/parser.h"
@@ -106,25 +107,23 @@ err:
 	return true;
 }
 
-bool
-eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
+static bool
+eval_cached(struct workspace *wk, struct source *src, enum eval_mode mode, enum ast_cache_flag cache_flags,
+	obj *res)
 {
 	TracyCZoneAutoS;
 	/* L("evaluating '%s'", src->label); */
 	interpreter_init();
 
 	bool ret = false;
-	struct ast ast = { 0 };
-
-	struct source_data *sdata =
-		darr_get(&wk->source_data, darr_push(&wk->source_data, &(struct source_data) { 0 }));
+	struct ast tmp = { 0 }, *ast;
 
 	enum parse_mode parse_mode = 0;
 	if (mode == eval_mode_repl) {
 		parse_mode |= pm_ignore_statement_with_no_effect;
 	}
 
-	if (!parser_parse(wk, &ast, sdata, src, parse_mode)) {
+	if (!ast_cache_parse(wk, src, parse_mode, cache_flags, &tmp, &ast)) {
 		goto ret;
 	}
 
@@ -132,10 +131,10 @@ eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
 	struct ast *old_ast = wk->ast;
 
 	wk->src = src;
-	wk->ast = &ast;
+	wk->ast = ast;
 
 	if (mode == eval_mode_first) {
-		if (!ensure_project_is_first_statement(wk, &ast, false)) {
+		if (!ensure_project_is_first_statement(wk, ast, false)) {
 			goto ret;
 		}
 	}
@@ -147,17 +146,23 @@ eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
 	}
 
 	if (wk->in_analyzer) {
-		analyze_check_dead_code(wk, &ast);
+		analyze_check_dead_code(wk, ast);
 	}
 
 	wk->src = old_src;
 	wk->ast = old_ast;
 ret:
-	ast_destroy(&ast);
+	ast_destroy(&tmp);
 	TracyCZoneAutoE;
 	return ret;
 }
 
+bool
+eval(struct workspace *wk, struct source *src, enum eval_mode mode, obj *res)
+{
+	return eval_cached(wk, src, mode, 0, res);
+}
+
 bool
 eval_str(struct workspace *wk, const char *str, enum eval_mode mode, obj *res)
 {
@@ -178,7 +183,7 @@ eval_project_file(struct workspace *wk, const char *path, bool first)
 	}
 
 	obj res;
-	if (!eval(wk, &src, first ? eval_mode_first : eval_mode_default, &res)) {
+	if (!eval_cached(wk, &src, first ? eval_mode_first : eval_mode_default, ast_cache_flag_persist, &res)) {
 		goto ret;
 	}
 
@@ -244,7 +249,7 @@ repl(struct workspace *wk, bool dbg)
 	};
 
 	if (dbg) {
-		list_line_range(wk->src, get_node(wk->ast, wk->dbg.node)->line, 1);
+		list_line_range(wk->src, get_node_loc(wk->ast, wk->dbg.node)->line, 1);
 
 		if (wk->dbg.stepping) {
 			cmd = repl_cmd_step;
@@ -326,7 +331,7 @@ cmd_found:
 				}
 				break;
 			case repl_cmd_list: {
-				list_line_range(wk->src, get_node(wk->ast, wk->dbg.node)->line, 11);
+				list_line_range(wk->src, get_node_loc(wk->ast, wk->dbg.node)->line, 11);
 				break;
 			}
 			case repl_cmd_step:
@@ -367,7 +372,7 @@ cmd_found:
 
 			if (repl_res) {
 				obj_fprintf(wk, out, "%o\n", repl_res);
-				hash_set_str(&wk->scope, "_", repl_res);
+				scope_set(wk, &wk->scope, "_", repl_res);
 			}
 		}
 cont:
@@ -58,9 +58,9 @@ static uint32_t fmt_node(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint
 static uint32_t fmt_chain(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_id);
 
 static const char *
-get_comment(struct fmt_ctx *ctx, struct node *n, uint32_t i)
+get_comment(struct fmt_ctx *ctx, struct node_comments *c, uint32_t i)
 {
-	return *(const char **)darr_get(&ctx->ast->comments, n->comments.start + i);
+	return *(const char **)darr_get(&ctx->ast->comments, c->start + i);
 }
 
 static bool
@@ -196,10 +196,11 @@ fmt_newline(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t next)
 		if (next != 0) {
 			struct node *n = get_node(ctx->ast, next);
 			if (n->type == node_block) {
-				n = get_node(ctx->ast, n->l);
+				next = n->l;
+				n = get_node(ctx->ast, next);
 			}
 
-			if (n->type == node_empty_line && !n->comments.len) {
+			if (n->type == node_empty_line && !get_node_comments(ctx->ast, next)->len) {
 				return;
 			}
 		}
@@ -277,9 +278,10 @@ static uint32_t
 fmt_comments(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_id, bool allow_leading_space)
 {
 	struct node *n = get_node(ctx->ast, n_id);
+	struct node_comments *c = get_node_comments(ctx->ast, n_id);
 	uint32_t len = 0;
 
-	if (!n->comments.len) {
+	if (!c->len) {
 		return 0;
 	}
 
@@ -288,12 +290,12 @@ fmt_comments(struct fmt_ctx *ctx, const struct fmt_stack *pfst, uint32_t n_id, b
 	ctx->force_ml = true;
 
 	uint32_t i;
-	for (i = 0; i < n->comments.len; ++i) {
+	for (i = 0; i < c->len; ++i) {
 		len += fmt_writef(ctx, pfst, "%s#%s",
 			leading_space ? " " : "",
-			get_comment(ctx, n, i));
+			get_comment(ctx, c, i));
 
-		if (i < n->comments.len - 1) { // && !trailing_line) {
+		if (i < c->len - 1) { // && !trailing_line) {
 			fmt_newline_force(ctx, pfst, n_id);
 		} else {
 			if (pfst->write) {
@@ -34,8 +34,8 @@ interp_diagnostic(struct workspace *wk, uint32_t n_id, enum log_level lvl, const
 	obj_vasprintf(wk, &buf, fmt, args);
 
 	if (n_id) {
-		struct node *n = get_node(wk->ast, n_id);
-		error_message(wk->src, n->line, n->col, lvl, buf.buf);
+		struct node_loc *loc = get_node_loc(wk->ast, n_id);
+		error_message(wk->src, loc->line, loc->col, lvl, buf.buf);
 	} else {
 		log_print(true, lvl, "%s", buf.buf);
 	}
@@ -283,20 +283,56 @@ typecheck_dict(struct workspace *wk, uint32_t n_id, obj dict, type_tag type)
 	}, typecheck_dict_iter);
 }
 
+static void
+assign_variable_sym(struct workspace *wk, uint32_t sym, obj o)
+{
+	scope_set_sym(&current_project(wk)->scope, sym, o);
+	if (wk->dbg.watched) {
+		const char *name = symbol_name(wk, sym);
+		if (obj_array_in(wk, wk->dbg.watched, make_str(wk, name))) {
+			LOG_I("watched variable \"%s\" changed", name);
+			repl(wk, true);
+		}
+	}
+}
+
 void
 assign_variable(struct workspace *wk, const char *name, obj o, uint32_t _n_id)
 {
-	hash_set_str(&current_project(wk)->scope, name, o);
-	if (wk->dbg.watched && obj_array_in(wk, wk->dbg.watched, make_str(wk, name))) {
-		LOG_I("watched variable \"%s\" changed", name);
-		repl(wk, true);
-	}
+	assign_variable_sym(wk, symbol_id(wk, name), o);
 }
 
 void
 unassign_variable(struct workspace *wk, const char *name)
 {
-	hash_unset_str(&current_project(wk)->scope, name);
+	scope_unset(wk, &current_project(wk)->scope, name);
+}
+
+/*
+ * Identifier nodes resolved by the parser carry their symbol id in l, which
+ * lets plain variable access skip the name lookup.  The analyzer replaces the
+ * variable functions, so it always goes through them by name.
+ */
+static void
+interp_assign_id(struct workspace *wk, uint32_t id_node, obj o, uint32_t n_id)
+{
+	struct node *n = get_node(wk->ast, id_node);
+
+	if (n->l && !wk->in_analyzer) {
+		assign_variable_sym(wk, n->l, o);
+	} else {
+		wk->assign_variable(wk, n->dat.s, o, n_id);
+	}
+}
+
+static bool
+interp_get_id(struct workspace *wk, struct node *n, obj *res)
+{
+	if (n->l && !wk->in_analyzer) {
+		return get_obj_id_sym(wk, n->l, res, wk->cur_project);
+	}
+
+	return wk->get_variable(wk, n->dat.s, res, wk->cur_project);
 }
 
 static bool interp_chained(struct workspace *wk, uint32_t node_id, obj l_id, obj *res);
@@ -626,7 +662,7 @@ interp_assign(struct workspace *wk, struct node *n, obj *_)
 		return false;
 	}
 
-	wk->assign_variable(wk, get_node(wk->ast, n->l)->dat.s, rhs, 0);
+	interp_assign_id(wk, n->l, rhs, 0);
 	return true;
 }
 
@@ -640,126 +676,95 @@ interp_plusassign(struct workspace *wk, uint32_t n_id, obj *_)
 		return false;
 	}
 
-	wk->assign_variable(wk, get_node(wk->ast, n->l)->dat.s, rhs, 0);
+	interp_assign_id(wk, n->l, rhs, 0);
 	return true;
 }
 
 static bool
 interp_array(struct workspace *wk, uint32_t n_id, obj *res)
 {
-	obj l, r;
+	obj l;
+	struct node *n;
 
-	struct node *n = get_node(wk->ast, n_id);
-	n->chflg |= node_visited;
+	make_obj(wk, res, obj_array);
 
-	if (n->type == node_empty) {
-		make_obj(wk, res, obj_array);
-		struct obj_array *arr = get_obj_array(wk, *res);
-		arr->len = 0;
-		arr->tail = *res;
-		return true;
-	}
+	while (true) {
+		n = get_node(wk->ast, n_id);
+		n->chflg |= node_visited;
 
-	if (n->subtype == arg_kwarg) {
-		interp_error(wk, n->l, "kwarg not valid in array constructor");
-		return false;
-	}
-
-	bool have_c = n->chflg & node_child_c && get_node(wk->ast, n->c)->type != node_empty;
+		if (n->type == node_empty) {
+			return true;
+		}
 
-	if (!wk->interp_node(wk, n->l, &l)) {
-		return false;
-	}
+		if (n->subtype == arg_kwarg) {
+			interp_error(wk, n->l, "kwarg not valid in array constructor");
+			return false;
+		}
 
-	if (have_c) {
-		if (!interp_array(wk, n->c, &r)) {
+		if (!wk->interp_node(wk, n->l, &l)) {
 			return false;
 		}
-	}
 
-	make_obj(wk, res, obj_array);
-	struct obj_array *arr = get_obj_array(wk, *res);
-	arr->val = l;
+		obj_array_push(wk, *res, l);
 
-	if ((arr->have_next = have_c)) {
-		struct obj_array *arr_r = get_obj_array(wk, r);
+		n = get_node(wk->ast, n_id);
+		if (!(n->chflg & node_child_c)) {
+			return true;
+		}
 
-		arr->len = arr_r->len + 1;
-		arr->tail = arr_r->tail;
-		arr->next = r;
-	} else {
-		arr->len = 1;
-		arr->tail = *res;
+		n_id = n->c;
 	}
-
-	return true;
 }
 
 static bool
 interp_dict(struct workspace *wk, uint32_t n_id, obj *res)
 {
-	obj key, value, tail;
-
-	struct node *n = get_node(wk->ast, n_id);
-	n->chflg |= node_visited;
-
-	if (n->type == node_empty) {
-		make_obj(wk, res, obj_dict);
-		struct obj_dict *dict = get_obj_dict(wk, *res);
-		dict->len = 0;
-		dict->tail = *res;
-		return true;
-	}
+	obj key, value;
+	struct node *n;
 
-	assert(n->type == node_argument);
+	make_obj(wk, res, obj_dict);
 
-	if (n->subtype != arg_kwarg) {
-		interp_error(wk, n->l, "non-kwarg not valid in dict constructor");
-		return false;
-	}
+	while (true) {
+		n = get_node(wk->ast, n_id);
+		n->chflg |= node_visited;
 
-	bool have_c = n->chflg & node_child_c && get_node(wk->ast, n->c)->type != node_empty;
+		if (n->type == node_empty) {
+			return true;
+		}
 
-	if (!wk->interp_node(wk, n->l, &key)) {
-		return false;
-	}
+		assert(n->type == node_argument);
 
-	if (!typecheck(wk, n->l, key, obj_string)) {
-		return false;
-	}
-
-	if (!wk->interp_node(wk, n->r, &value)) {
-		return false;
-	}
+		if (n->subtype != arg_kwarg) {
+			interp_error(wk, n->l, "non-kwarg not valid in dict constructor");
+			return false;
+		}
 
-	if (have_c) {
-		if (!interp_dict(wk, n->c, &tail)) {
+		if (!wk->interp_node(wk, n->l, &key)) {
 			return false;
 		}
-	}
 
-	make_obj(wk, res, obj_dict);
-	struct obj_dict *dict = get_obj_dict(wk, *res);
-	dict->key = key;
-	dict->val = value;
+		if (!typecheck(wk, n->l, key, obj_string)) {
+			return false;
+		}
 
-	if ((dict->have_next = have_c)) {
-		struct obj_dict *dict_r = get_obj_dict(wk, tail);
+		if (!wk->interp_node(wk, n->r, &value)) {
+			return false;
+		}
 
-		if (obj_dict_in(wk, tail, key)) {
+		if (obj_dict_in(wk, *res, key)) {
 			interp_error(wk, n->l, "key %o is duplicated", key);
 			return false;
 		}
 
-		dict->len = dict_r->len + 1;
-		dict->tail = dict_r->tail;
-		dict->next = tail;
-	} else {
-		dict->len = 1;
-		dict->tail = *res;
-	}
+		obj_dict_set(wk, *res, key, value);
 
-	return true;
+		n = get_node(wk->ast, n_id);
+		if (!(n->chflg & node_child_c)) {
+			return true;
+		}
+
+		n_id = n->c;
+	}
 }
 
 static bool
@@ -983,7 +988,6 @@ interp_if(struct workspace *wk, struct node *n, obj *res)
 }
 
 struct interp_foreach_ctx {
-	const char *id1, *id2;
 	uint32_t n_l, n_r;
 	uint32_t block_node;
 };
@@ -1024,8 +1028,8 @@ interp_foreach_dict_iter(struct workspace *wk, void *_ctx, obj k_id, obj v_id)
 {
 	struct interp_foreach_ctx *ctx = _ctx;
 
-	wk->assign_variable(wk, ctx->id1, k_id, ctx->n_l);
-	wk->assign_variable(wk, ctx->id2, v_id, ctx->n_r);
+	interp_assign_id(wk, ctx->n_l, k_id, ctx->n_l);
+	interp_assign_id(wk, ctx->n_r, v_id, ctx->n_r);
 
 	return interp_foreach_common(wk, ctx);
 }
@@ -1035,7 +1039,7 @@ interp_foreach_arr_iter(struct workspace *wk, void *_ctx, obj v_id)
 {
 	struct interp_foreach_ctx *ctx = _ctx;
 
-	wk->assign_variable(wk, ctx->id1, v_id, ctx->n_l);
+	interp_assign_id(wk, ctx->n_l, v_id, ctx->n_l);
 
 	return interp_foreach_common(wk, ctx);
 }
@@ -1058,7 +1062,6 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 			}
 
 			struct interp_foreach_ctx ctx = {
-				.id1 = get_node(wk->ast, args->l)->dat.s,
 				.n_l = args->l,
 				.block_node = n->c,
 			};
@@ -1109,7 +1112,6 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 		}
 
 		struct interp_foreach_ctx ctx = {
-			.id1 = get_node(wk->ast, args->l)->dat.s,
 			.n_l = args->l,
 			.block_node = n->c,
 		};
@@ -1130,8 +1132,6 @@ interp_foreach(struct workspace *wk, struct node *n, obj *res)
 		assert(get_node(wk->ast, get_node(wk->ast, args->r)->type == node_foreach_args));
 
 		struct interp_foreach_ctx ctx = {
-			.id1 = get_node(wk->ast, args->l)->dat.s,
-			.id2 = get_node(wk->ast, get_node(wk->ast, args->r)->l)->dat.s,
 			.n_l = args->l,
 			.n_r = get_node(wk->ast, args->r)->l,
 			.block_node = n->c,
@@ -1219,7 +1219,7 @@ interp_node(struct workspace *wk, uint32_t n_id, obj *res)
 		ret = interp_dict(wk, n->l, res);
 		break;
 	case node_id:
-		if (!wk->get_variable(wk, n->dat.s, res, wk->cur_project)) {
+		if (!interp_get_id(wk, n, res)) {
 			interp_error(wk, n_id, "undefined object");
 			ret = false;
 			break;
@@ -1257,9 +1257,9 @@ interp_block:
 		if (!is_internal
 		    && was_stepping
 		    && wk->dbg.stepping
-		    && wk->dbg.last_line != get_node(wk->ast, n->l)->line) {
+		    && wk->dbg.last_line != get_node_loc(wk->ast, n->l)->line) {
 			wk->dbg.node = n->l;
-			wk->dbg.last_line = get_node(wk->ast, n->l)->line;
+			wk->dbg.last_line = get_node_loc(wk->ast, n->l)->line;
 			repl(wk, true);
 		}
 
@@ -280,8 +280,10 @@ void
 obj_set_clear_mark(struct workspace *wk, struct obj_clear_mark *mk)
 {
 	mk->obji = wk->objs.len;
+	mk->dict_hashes = wk->dict_hashes.len;
 
 	bucket_array_save(&wk->chrs, &mk->chrs);
+	bucket_array_save(&wk->array_elems, &mk->array_elems);
 	bucket_array_save(&wk->objs, &mk->objs);
 	uint32_t i;
 	for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
@@ -301,14 +303,37 @@ obj_clear(struct workspace *wk, const struct obj_clear_mark *mk)
 			ss = bucket_array_get(
 				&wk->obj_aos[obj_string - _obj_aos_start], o->val);
 
+			if (ss->flags & str_flag_interned) {
+				hash_unset(&wk->interned_strs, ss);
+			}
+
 			if (ss->flags & str_flag_big) {
 				z_free((void *)ss->s);
 			}
+		} else if (o->t == obj_array) {
+			struct obj_array *a = bucket_array_get(
+				&wk->obj_aos[obj_array - _obj_aos_start], o->val);
+
+			if (a->flags & obj_array_flag_big) {
+				z_free(a->e);
+			}
 		}
 	}
 
+	/* Indices are built lazily on lookup, so dicts from before the mark
+	 * may own indices that are about to be destroyed. */
+	for (i = mk->dict_hashes; i < wk->dict_hashes.len; ++i) {
+		const struct obj_dict_hash *h = darr_get(&wk->dict_hashes, i);
+		if (h->dict < mk->obji) {
+			get_obj_dict(wk, h->dict)->flags &= ~obj_dict_flag_hashed;
+		}
+	}
+
+	obj_dict_hashes_destroy(wk, mk->dict_hashes);
+
 	bucket_array_restore(&wk->objs, &mk->objs);
 	bucket_array_restore(&wk->chrs, &mk->chrs);
+	bucket_array_restore(&wk->array_elems, &mk->array_elems);
 
 	for (i = 0; i < obj_type_count - _obj_aos_start; ++i) {
 		bucket_array_restore(&wk->obj_aos[i], &mk->obj_aos[i]);
@@ -410,8 +435,16 @@ obj_equal(struct workspace *wk, obj left, obj right)
 	}
 
 	switch (t) {
-	case obj_string:
-		return str_eql(get_str(wk, left), get_str(wk, right));
+	case obj_string: {
+		const struct str *l = get_str(wk, left),
+				 *r = get_str(wk, right);
+
+		if ((l->flags & str_flag_interned) && (r->flags & str_flag_interned)) {
+			return false;
+		}
+
+		return str_eql(l, r);
+	}
 	case obj_file:
 		return str_eql(get_str(wk, *get_obj_file(wk, left)),
 			get_str(wk, *get_obj_file(wk, right)));
@@ -463,17 +496,67 @@ obj_equal(struct workspace *wk, obj left, obj right)
  * arrays
  */
 
-bool
-obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator cb)
+/*
+ * Array elements are stored contiguously.  Small arrays live in
+ * wk->array_elems, and are copied to a fresh region when they grow, the same
+ * way strings are grown in wk->chrs.  Once an array's capacity exceeds
+ * OBJ_ARRAY_BIG, its elements are moved to a separately allocated buffer
+ * that is resized in place.
+ */
+
+#define OBJ_ARRAY_BIG 1024
+
+static void
+obj_array_grow(struct workspace *wk, struct obj_array *a, uint32_t len)
 {
-	struct obj_array *a = get_obj_array(wk, arr);
+	uint32_t cap;
 
-	if (!a->len) {
-		return true;
+	if (len <= a->cap) {
+		return;
 	}
 
-	while (true) {
-		switch (cb(wk, ctx, a->val)) {
+	for (cap = a->cap ? a->cap : 4; cap < len; cap <<= 1) {
+	}
+
+	if (a->flags & obj_array_flag_big) {
+		a->e = z_realloc(a->e, cap * sizeof(obj));
+	} else if (cap > OBJ_ARRAY_BIG) {
+		obj *e = z_malloc(cap * sizeof(obj));
+		if (a->len) {
+			memcpy(e, a->e, a->len * sizeof(obj));
+		}
+		a->e = e;
+		a->flags |= obj_array_flag_big;
+	} else {
+		a->e = bucket_array_pushn(&wk->array_elems, a->e, a->len, cap);
+	}
+
+	a->cap = cap;
+}
+
+static void
+obj_array_pushn(struct workspace *wk, obj arr, const obj *e, uint32_t n)
+{
+	if (!n) {
+		return;
+	}
+
+	struct obj_array *a = get_obj_array(wk, arr);
+	obj_array_grow(wk, a, a->len + n);
+	memcpy(&a->e[a->len], e, n * sizeof(obj));
+	a->len += n;
+}
+
+bool
+obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator cb)
+{
+	// The callback may push to this array, so elements must be re-read
+	// through a on every iteration.
+	const struct obj_array *a = get_obj_array(wk, arr);
+	uint32_t i;
+
+	for (i = 0; i < a->len; ++i) {
+		switch (cb(wk, ctx, a->e[i])) {
 		case ir_cont:
 			break;
 		case ir_done:
@@ -481,12 +564,6 @@ obj_array_foreach(struct workspace *wk, obj arr, void *ctx, obj_array_iterator c
 		case ir_err:
 			return false;
 		}
-
-		if (!a->have_next) {
-			break;
-		}
-
-		a = get_obj_array(wk, a->next);
 	}
 
 	return true;
@@ -534,29 +611,13 @@ obj_array_foreach_flat(struct workspace *wk, obj arr, void *usr_ctx, obj_array_i
 void
 obj_array_push(struct workspace *wk, obj arr, obj child)
 {
-	obj child_arr;
-	struct obj_array *a, *tail, *c;
+	struct obj_array *a = get_obj_array(wk, arr);
 
-	if (!(a = get_obj_array(wk, arr))->len) {
-		a->tail = arr;
-		a->len = 1;
-		a->val = child;
-		a->have_next = false;
-		return;
+	if (a->len >= a->cap) {
+		obj_array_grow(wk, a, a->len + 1);
 	}
 
-	make_obj(wk, &child_arr, obj_array);
-	c = get_obj_array(wk, child_arr);
-	c->val = child;
-
-	a = get_obj_array(wk, arr);
-	tail = get_obj_array(wk, a->tail);
-	assert(!tail->have_next);
-
-	tail->have_next = true;
-	tail->next = child_arr;
-
-	a->tail = child_arr;
+	a->e[a->len] = child;
 	++a->len;
 }
 
@@ -570,34 +631,20 @@ obj_array_prepend(struct workspace *wk, obj *arr, obj val)
 	*arr = prepend;
 }
 
-struct obj_array_index_of_iter_ctx {
-	obj l;
-	bool res;
-	uint32_t i;
-};
-
-static enum iteration_result
-obj_array_index_of_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_index_of_iter_ctx *ctx = _ctx;
-
-	if (obj_equal(wk, ctx->l, v)) {
-		ctx->res = true;
-		return ir_done;
-	}
-
-	++ctx->i;
-	return ir_cont;
-}
-
 bool
 obj_array_index_of(struct workspace *wk, obj arr, obj val, uint32_t *idx)
 {
-	struct obj_array_index_of_iter_ctx ctx = { .l = val };
-	obj_array_foreach(wk, arr, &ctx, obj_array_index_of_iter);
+	const struct obj_array *a = get_obj_array(wk, arr);
+	uint32_t i;
 
-	*idx = ctx.i;
-	return ctx.res;
+	for (i = 0; i < a->len; ++i) {
+		if (obj_equal(wk, val, a->e[i])) {
+			break;
+		}
+	}
+
+	*idx = i;
+	return i < a->len;
 }
 
 bool
@@ -607,79 +654,41 @@ obj_array_in(struct workspace *wk, obj arr, obj val)
 	return obj_array_index_of(wk, arr, val, &_);
 }
 
-struct obj_array_index_iter_ctx { obj res, i, tgt; };
-
-static enum iteration_result
-obj_array_index_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_index_iter_ctx *ctx = _ctx;
-
-	if (ctx->i == ctx->tgt) {
-		ctx->res = v;
-		return ir_done;
-	}
-
-	++ctx->i;
-	return ir_cont;
-}
-
 void
 obj_array_index(struct workspace *wk, obj arr, int64_t i, obj *res)
 {
-	struct obj_array_index_iter_ctx ctx = { .tgt = i };
-	assert(i >= 0 && i < get_obj_array(wk, arr)->len);
-	obj_array_foreach(wk, arr, &ctx, obj_array_index_iter);
-	*res = ctx.res;
-}
-
-struct obj_array_dup_ctx { obj *arr; };
-
-static enum iteration_result
-obj_array_dup_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_dup_ctx *ctx = _ctx;
-	obj_array_push(wk, *ctx->arr, v);
-	return ir_cont;
+	const struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
+	*res = a->e[i];
 }
 
 void
 obj_array_dup(struct workspace *wk, obj arr, obj *res)
 {
-	struct obj_array_dup_ctx ctx = { .arr = res };
 	make_obj(wk, res, obj_array);
-	obj_array_foreach(wk, arr, &ctx, obj_array_dup_iter);
+	obj_array_extend_nodup(wk, *res, arr);
 }
 
 void
 obj_array_extend_nodup(struct workspace *wk, obj arr, obj arr2)
 {
-	struct obj_array *a, *b, *tail;
-
-	if (!(b = get_obj_array(wk, arr2))->len) {
-		return;
-	}
+	const struct obj_array *b = get_obj_array(wk, arr2);
+	uint32_t len = b->len;
 
-	if (!(a = get_obj_array(wk, arr))->len) {
-		struct obj_array_dup_ctx ctx = { .arr = &arr };
-		obj_array_foreach(wk, arr2, &ctx, obj_array_dup_iter);
+	if (!len) {
 		return;
 	}
 
-	tail = get_obj_array(wk, a->tail);
-	assert(!tail->have_next);
-	tail->have_next = true;
-	tail->next = arr2;
+	obj_array_grow(wk, get_obj_array(wk, arr), get_obj_array(wk, arr)->len + len);
 
-	a->tail = b->tail;
-	a->len += b->len;
+	// b->e must be read after growing in case arr == arr2
+	obj_array_pushn(wk, arr, b->e, len);
 }
 
 void
 obj_array_extend(struct workspace *wk, obj arr, obj arr2)
 {
-	obj dup;
-	obj_array_dup(wk, arr2, &dup);
-	obj_array_extend_nodup(wk, arr, dup);
+	obj_array_extend_nodup(wk, arr, arr2);
 }
 
 struct obj_array_join_ctx {
@@ -699,10 +708,10 @@ obj_array_join_iter(struct workspace *wk, void *_ctx, obj val)
 
 	const struct str *ss = get_str(wk, val);
 
-	str_appn(wk, *ctx->res, ss->s, ss->len);
+	str_appn(wk, ctx->res, ss->s, ss->len);
 
 	if (ctx->i < ctx->len - 1) {
-		str_appn(wk, *ctx->res, ctx->join->s, ctx->join->len);
+		str_appn(wk, ctx->res, ctx->join->s, ctx->join->len);
 	}
 
 	++ctx->i;
@@ -752,85 +761,44 @@ obj_array_join(struct workspace *wk, bool flat, obj arr, obj join, obj *res)
 void
 obj_array_tail(struct workspace *wk, obj arr, obj *res)
 {
+	make_obj(wk, res, obj_array);
+
 	const struct obj_array *a = get_obj_array(wk, arr);
 
-	if (a->have_next) {
-		struct obj_array *n = get_obj_array(wk, a->next);
-		n->tail = a->tail;
-		n->len = a->len;
-		*res = a->next;
-	} else {
-		// the tail of a zero or single element array is an empty array
-		make_obj(wk, res, obj_array);
+	// the tail of a zero or single element array is an empty array
+	if (a->len > 1) {
+		obj_array_pushn(wk, *res, &a->e[1], a->len - 1);
 	}
 }
 
 void
 obj_array_set(struct workspace *wk, obj arr, int64_t i, obj v)
 {
-	assert(i >= 0 && i < get_obj_array(wk, arr)->len);
-
-	uint32_t j = 0;
-
-	while (true) {
-		if (j == i) {
-			get_obj_array(wk, arr)->val = v;
-			return;
-		}
-
-		assert(get_obj_array(wk, arr)->have_next);
-		arr = get_obj_array(wk, arr)->next;
-		++j;
-	}
-
-	assert(false && "unreachable");
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
+	a->e[i] = v;
 }
 
 void
 obj_array_del(struct workspace *wk, obj arr, int64_t i)
 {
-	uint32_t j = 0;
-	obj p = arr;
-	struct obj_array *head = get_obj_array(wk, arr),
-			 *prev, *next,
-			 *del;
-
-	assert(i >= 0 && i < head->len);
-
-	if (i == 0) {
-		if (head->have_next) {
-			next = get_obj_array(wk, head->next);
-			next->len = head->len - 1;
-			next->tail = head->tail;
-			*head = *next;
-		} else {
-			*head = (struct obj_array) { 0 };
-		}
-
-		return;
-	}
-
-	while (true) {
-		if (j == i) {
-			del = get_obj_array(wk, arr);
-			break;
-		}
-
-		p = arr;
-		assert(get_obj_array(wk, arr)->have_next);
-		arr = get_obj_array(wk, arr)->next;
-		++j;
-	}
+	struct obj_array *a = get_obj_array(wk, arr);
+	assert(i >= 0 && i < a->len);
 
-	prev = get_obj_array(wk, p);
+	--a->len;
+	memmove(&a->e[i], &a->e[i + 1], (a->len - i) * sizeof(obj));
+}
 
-	if (del->have_next) {
-		prev->next = del->next;
-	} else {
-		prev->have_next = false;
-	}
+struct obj_array_dedup_ctx {
+	obj res;
+	bool all_interned;
+};
 
-	--head->len;
+static bool
+obj_is_interned_str(struct workspace *wk, obj val)
+{
+	return get_obj_type(wk, val) == obj_string
+	       && (get_str(wk, val)->flags & str_flag_interned);
 }
 
 static enum iteration_result
@@ -841,9 +809,14 @@ obj_array_dedup_iter(struct workspace *wk, void *_ctx, obj val)
 	}
 	hash_set(&wk->obj_hash, &val, true);
 
-	obj *res = _ctx;
-	if (!obj_array_in(wk, *res, val)) {
-		obj_array_push(wk, *res, val);
+	struct obj_array_dedup_ctx *ctx = _ctx;
+	bool interned = obj_is_interned_str(wk, val);
+
+	/* an interned string that hasn't been seen by id can only be equal
+	 * to an element that isn't interned */
+	if ((interned && ctx->all_interned) || !obj_array_in(wk, ctx->res, val)) {
+		obj_array_push(wk, ctx->res, val);
+		ctx->all_interned &= interned;
 	}
 
 	return ir_cont;
@@ -854,8 +827,10 @@ obj_array_dedup(struct workspace *wk, obj arr, obj *res)
 {
 	hash_clear(&wk->obj_hash);
 
-	make_obj(wk, res, obj_array);
-	obj_array_foreach(wk, arr, res, obj_array_dedup_iter);
+	struct obj_array_dedup_ctx ctx = { .all_interned = true };
+	make_obj(wk, &ctx.res, obj_array);
+	obj_array_foreach(wk, arr, &ctx, obj_array_dedup_iter);
+	*res = ctx.res;
 }
 
 void
@@ -879,7 +854,7 @@ obj_array_flatten_one(struct workspace *wk, obj val, obj *res)
 		struct obj_array *v = get_obj_array(wk, val);
 
 		if (v->len == 1) {
-			obj_array_index(wk, val, 0, res);
+			*res = v->e[0];
 		} else {
 			return false;
 		}
@@ -901,14 +876,6 @@ obj_array_sort_by_str(struct workspace *wk, void *_ctx, obj a, obj b)
 	return memcmp(sa->s, sb->s, min);
 }
 
-static enum iteration_result
-obj_array_sort_push_to_da_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct darr *da = _ctx;
-	darr_push(da, &v);
-	return ir_cont;
-}
-
 struct obj_array_sort_ctx {
 	struct workspace *wk;
 	void *usr_ctx;
@@ -935,63 +902,36 @@ obj_array_sort(struct workspace *wk, void *usr_ctx, obj arr, obj_array_sort_func
 
 	struct darr da;
 	darr_init(&da, len, sizeof(obj));
-	obj_array_foreach(wk, arr, &da, obj_array_sort_push_to_da_iter);
+	darr_grow_by(&da, len);
+	memcpy(da.e, get_obj_array(wk, arr)->e, len * sizeof(obj));
 
 	struct obj_array_sort_ctx ctx = { .wk = wk, .usr_ctx = usr_ctx, .func = func, };
 
 	darr_sort(&da, &ctx, obj_array_sort_wrapper);
 
 	make_obj(wk, res, obj_array);
-
-	uint32_t i;
-	for (i = 0; i < da.len; ++i) {
-		obj_array_push(wk, *res, *(obj *)darr_get(&da, i));
-	}
+	obj_array_pushn(wk, *res, (obj *)da.e, len);
 
 	darr_destroy(&da);
 }
 
-struct obj_array_slice_ctx {
-	int64_t i, i0, i1;
-	obj res;
-};
-
-static enum iteration_result
-obj_array_slice_iter(struct workspace *wk, void *_ctx, obj v)
-{
-	struct obj_array_slice_ctx *ctx = _ctx;
-
-	if (ctx->i >= ctx->i0) {
-		obj_array_push(wk, ctx->res, v);
-	}
-
-	++ctx->i;
-
-	if (ctx->i > ctx->i1) {
-		return ir_done;
-	}
-
-	return ir_cont;
-}
-
 obj
 obj_array_slice(struct workspace *wk, obj a, int64_t i0, int64_t i1)
 {
+	obj res;
 	struct obj_array *arr = get_obj_array(wk, a);
 	if (!(bounds_adjust(wk, arr->len, &i0) && bounds_adjust(wk, arr->len, &i1))) {
 		assert(false && "index out of bounds");
 	}
 
-	struct obj_array_slice_ctx ctx = {
-		.i0 = i0,
-		.i1 = i1,
-	};
-
-	make_obj(wk, &ctx.res, obj_array);
+	make_obj(wk, &res, obj_array);
 
-	obj_array_foreach(wk, a, &ctx, obj_array_slice_iter);
+	if (i1 >= i0) {
+		arr = get_obj_array(wk, a);
+		obj_array_pushn(wk, res, &arr->e[i0], i1 - i0 + 1);
+	}
 
-	return ctx.res;
+	return res;
 }
 
 /*
@@ -1077,19 +1017,134 @@ static bool
 obj_dict_key_comparison_func_string(struct workspace *wk, union obj_dict_key_comparison_key *key, obj other)
 {
 	const struct str *ss_a = get_str(wk, other);
+
+	if ((ss_a->flags & str_flag_interned) && (key->string.flags & str_flag_interned)) {
+		return ss_a->s == key->string.s;
+	}
+
 	return str_eql(ss_a, &key->string);
 }
 
 static bool
-obj_dict_key_comparison_func_objstr(struct workspace *wk, union obj_dict_key_comparison_key *key, obj other)
+obj_dict_key_comparison_func_int(struct workspace *wk, union obj_dict_key_comparison_key *key, uint32_t other)
 {
-	return str_eql(get_str(wk, key->num), get_str(wk, other));
+	return key->num == other;
 }
 
-static bool
-obj_dict_key_comparison_func_int(struct workspace *wk, union obj_dict_key_comparison_key *key, uint32_t other)
+/*
+ * Dicts are a linked list of obj_dict nodes, with the head node holding the
+ * length and tail.  This keeps iteration in insertion order, but makes
+ * lookup linear.  Once a dict grows past OBJ_DICT_HASH_THRESHOLD entries, an
+ * open addressing index mapping key hashes to list nodes is built and stored
+ * in wk->dict_hashes.  The list itself is left untouched, so iteration,
+ * cloning, and serialization don't need to know about the index.
+ */
+
+#define OBJ_DICT_HASH_THRESHOLD 16
+
+struct obj_dict_hash_slot {
+	uint64_t hv;
+	obj node; // obj_dict, 0 if empty
+};
+
+static uint64_t
+obj_dict_hash_key(union obj_dict_key_comparison_key *key, obj_dict_key_comparison_func comp)
 {
-	return key->num == other;
+	if (comp == obj_dict_key_comparison_func_int) {
+		struct str ss = { .s = (const char *)&key->num, .len = sizeof(uint32_t) };
+		return str_hash(&ss);
+	}
+
+	return str_hash(&key->string);
+}
+
+static struct obj_dict_hash *
+obj_dict_get_hash(struct workspace *wk, struct obj_dict *d)
+{
+	return darr_get(&wk->dict_hashes, d->hash);
+}
+
+static void
+obj_dict_hash_init_slots(struct obj_dict_hash *h, uint32_t cap)
+{
+	darr_init(&h->slots, cap, sizeof(struct obj_dict_hash_slot));
+	darr_grow_by(&h->slots, cap);
+	memset(h->slots.e, 0, cap * sizeof(struct obj_dict_hash_slot));
+}
+
+static void
+obj_dict_hash_insert_slot(struct obj_dict_hash *h, uint64_t hv, obj node)
+{
+	struct obj_dict_hash_slot *slots = (struct obj_dict_hash_slot *)h->slots.e;
+	const uint64_t mask = h->slots.len - 1;
+	uint64_t i = hv & mask;
+
+	while (slots[i].node) {
+		i = (i + 1) & mask;
+	}
+
+	slots[i] = (struct obj_dict_hash_slot) { .hv = hv, .node = node };
+	++h->len;
+}
+
+static void
+obj_dict_hash_insert(struct workspace *wk, struct obj_dict_hash *h, uint64_t hv, obj node)
+{
+	if ((h->len + 1) * 2 > h->slots.len) {
+		struct obj_dict_hash_slot *old_slots = (struct obj_dict_hash_slot *)h->slots.e;
+		uint32_t i, old_cap = h->slots.len;
+		struct darr old = h->slots;
+
+		obj_dict_hash_init_slots(h, old_cap * 2);
+		h->len = 0;
+
+		for (i = 0; i < old_cap; ++i) {
+			if (old_slots[i].node) {
+				obj_dict_hash_insert_slot(h, old_slots[i].hv, old_slots[i].node);
+			}
+		}
+
+		darr_destroy(&old);
+	}
+
+	obj_dict_hash_insert_slot(h, hv, node);
+}
+
+static void
+obj_dict_build_hash(struct workspace *wk, obj dict, obj_dict_key_comparison_func comp)
+{
+	struct obj_dict_hash h = { .dict = dict };
+	uint32_t cap = 32;
+	while (cap < get_obj_dict(wk, dict)->len * 2) {
+		cap <<= 1;
+	}
+
+	obj_dict_hash_init_slots(&h, cap);
+
+	obj node = dict;
+	union obj_dict_key_comparison_key k;
+	struct obj_dict *d;
+
+	while (true) {
+		d = get_obj_dict(wk, node);
+
+		if (comp == obj_dict_key_comparison_func_int) {
+			k.num = d->key;
+		} else {
+			k.string = *get_str(wk, d->key);
+		}
+
+		obj_dict_hash_insert(wk, &h, obj_dict_hash_key(&k, comp), node);
+
+		if (!d->have_next) {
+			break;
+		}
+		node = d->next;
+	}
+
+	d = get_obj_dict(wk, dict);
+	d->hash = darr_push(&wk->dict_hashes, &h);
+	d->flags |= obj_dict_flag_hashed;
 }
 
 static bool
@@ -1099,7 +1154,35 @@ _obj_dict_index(struct workspace *wk, obj dict,
 	obj **res)
 
 {
-	if (!get_obj_dict(wk, dict)->len) {
+	struct obj_dict *d = get_obj_dict(wk, dict);
+
+	if (!d->len) {
+		return false;
+	}
+
+	if (!(d->flags & obj_dict_flag_hashed) && d->len > OBJ_DICT_HASH_THRESHOLD) {
+		obj_dict_build_hash(wk, dict, comp);
+		d = get_obj_dict(wk, dict);
+	}
+
+	if (d->flags & obj_dict_flag_hashed) {
+		struct obj_dict_hash *h = obj_dict_get_hash(wk, d);
+		const struct obj_dict_hash_slot *slots = (const struct obj_dict_hash_slot *)h->slots.e;
+		const uint64_t hv = obj_dict_hash_key(key, comp), mask = h->slots.len - 1;
+		uint64_t i;
+
+		for (i = hv & mask; slots[i].node; i = (i + 1) & mask) {
+			if (slots[i].hv != hv) {
+				continue;
+			}
+
+			d = get_obj_dict(wk, slots[i].node);
+			if (comp(wk, key, d->key)) {
+				*res = &d->val;
+				return true;
+			}
+		}
+
 		return false;
 	}
 
@@ -1140,8 +1223,17 @@ obj_dict_index_strn(struct workspace *wk, obj dict, const char *str,
 bool
 obj_dict_index(struct workspace *wk, obj dict, obj key, obj *res)
 {
-	const struct str *k = get_str(wk, key);
-	return obj_dict_index_strn(wk, dict, k->s, k->len, res);
+	obj *r;
+	union obj_dict_key_comparison_key k = { .string = *get_str(wk, key) };
+
+	if (!_obj_dict_index(wk, dict, &k,
+		obj_dict_key_comparison_func_string, &r)) {
+		return false;
+	}
+
+	*res = *r;
+
+	return true;
 }
 
 bool
@@ -1153,6 +1245,7 @@ obj_dict_in(struct workspace *wk, obj dict, obj key)
 
 static void
 _obj_dict_set(struct workspace *wk, obj dict,
+	union obj_dict_key_comparison_key *k,
 	obj_dict_key_comparison_func comp, obj key, obj val)
 {
 	struct obj_dict *d; //, *tail;
@@ -1168,8 +1261,7 @@ _obj_dict_set(struct workspace *wk, obj dict,
 	}
 
 	obj *r;
-	union obj_dict_key_comparison_key k = { .num = key };
-	if (_obj_dict_index(wk, dict, &k, comp, &r)) {
+	if (_obj_dict_index(wk, dict, k, comp, &r)) {
 		*r = val;
 		return;
 	}
@@ -1189,12 +1281,17 @@ _obj_dict_set(struct workspace *wk, obj dict,
 
 	d->tail = tail;
 	++d->len;
+
+	if (d->flags & obj_dict_flag_hashed) {
+		obj_dict_hash_insert(wk, obj_dict_get_hash(wk, d), obj_dict_hash_key(k, comp), tail);
+	}
 }
 
 void
 obj_dict_set(struct workspace *wk, obj dict, obj key, obj val)
 {
-	_obj_dict_set(wk, dict, obj_dict_key_comparison_func_objstr, key, val);
+	union obj_dict_key_comparison_key k = { .string = *get_str(wk, key) };
+	_obj_dict_set(wk, dict, &k, obj_dict_key_comparison_func_string, key, val);
 }
 
 /* dict convienence functions */
@@ -1202,7 +1299,8 @@ obj_dict_set(struct workspace *wk, obj dict, obj key, obj val)
 void
 obj_dict_seti(struct workspace *wk, obj dict, uint32_t key, obj val)
 {
-	_obj_dict_set(wk, dict, obj_dict_key_comparison_func_int, key, val);
+	union obj_dict_key_comparison_key k = { .num = key };
+	_obj_dict_set(wk, dict, &k, obj_dict_key_comparison_func_int, key, val);
 }
 
 bool
@@ -1219,6 +1317,17 @@ obj_dict_geti(struct workspace *wk, obj dict, uint32_t key, obj *val)
 	return false;
 }
 
+void
+obj_dict_hashes_destroy(struct workspace *wk, uint32_t start)
+{
+	uint32_t i;
+	for (i = start; i < wk->dict_hashes.len; ++i) {
+		darr_destroy(&((struct obj_dict_hash *)darr_get(&wk->dict_hashes, i))->slots);
+	}
+
+	wk->dict_hashes.len = start;
+}
+
 /* */
 
 struct obj_iterable_foreach_ctx {
@@ -1314,7 +1423,12 @@ obj_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val, obj *ret
 		set_obj_bool(wk_dest, *ret, get_obj_bool(wk_src, val));
 		return true;
 	case obj_string: {
-		*ret = str_clone(wk_src, wk_dest, val);
+		const struct str *ss = get_str(wk_src, val);
+		if (ss->flags & str_flag_interned) {
+			*ret = make_strn_interned(wk_dest, ss->s, ss->len);
+		} else {
+			*ret = str_clone(wk_src, wk_dest, val);
+		}
 		return true;
 	}
 	case obj_file:
@@ -1406,6 +1520,7 @@ obj_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val, obj *ret
 
 		o->source = opt->source;
 		o->type = opt->type;
+		o->kind = opt->kind;
 		o->builtin = opt->builtin;
 		o->yield = opt->yield;
 
@@ -15,6 +15,7 @@
 #include "lang/lexer.h"
 #include "lang/parser.h"
 #include "lang/string.h"
+#include "lang/workspace.h"
 #include "log.h"
 #include "tracy.h"
 
@@ -115,14 +116,14 @@ static void
 accept_comment(struct parser *p)
 {
 	if (p->last->type == tok_comment) {
-		struct node *n = darr_get(&p->ast->nodes, p->ast->nodes.len - 1);
+		struct node_comments *c = get_node_comments(p->ast, p->ast->nodes.len - 1);
 
-		if (!n->comments.len) {
-			n->comments.start = p->ast->comments.len;
+		if (!c->len) {
+			c->start = p->ast->comments.len;
 		}
 
 		darr_push(&p->ast->comments, &p->last->dat.s);
-		++n->comments.len;
+		++c->len;
 		get_next_tok(p);
 	}
 }
@@ -174,18 +175,59 @@ get_node(struct ast *ast, uint32_t i)
 	return darr_get(&ast->nodes, i);
 }
 
+struct node_loc *
+get_node_loc(struct ast *ast, uint32_t i)
+{
+	return darr_get(&ast->locs, i);
+}
+
+struct node_comments *
+get_node_comments(struct ast *ast, uint32_t i)
+{
+	return darr_get(&ast->node_comments, i);
+}
+
+void
+node_init_value(struct workspace *wk, struct node *n)
+{
+	switch (n->type) {
+	case node_bool:
+		make_obj(wk, &n->l, obj_bool);
+		set_obj_bool(wk, n->l, n->subtype);
+		break;
+	case node_id:
+		n->l = symbol_id(wk, n->dat.s);
+		break;
+	case node_number:
+		make_obj(wk, &n->l, obj_number);
+		set_obj_number(wk, n->l, n->dat.n);
+		break;
+	case node_string:
+		n->l = make_strn_interned(wk, n->dat.s, n->subtype);
+		break;
+	default:
+		break;
+	}
+}
+
 static struct node *
 make_node(struct parser *p, uint32_t *idx, enum node_type t)
 {
 	*idx = darr_push(&p->ast->nodes, &(struct node){ .type = t });
 	struct node *n = darr_get(&p->ast->nodes, *idx);
+	struct node_loc loc = { 0 };
 
 	if (p->last_last) {
-		n->line = p->last_last->line;
-		n->col = p->last_last->col;
+		loc = (struct node_loc){ p->last_last->line, p->last_last->col };
 		n->dat = p->last_last->dat;
 	}
 
+	darr_push(&p->ast->locs, &loc);
+
+	if (p->mode & pm_keep_formatting) {
+		darr_push(&p->ast->node_comments, &(struct node_comments){ 0 });
+	}
+
 	return n;
 }
 
@@ -503,33 +545,23 @@ parse_e9(struct parser *p, uint32_t *id)
 	if (accept(p, tok_true)) {
 		n = make_node(p, id, node_bool);
 		n->subtype = 1;
-		if (p->wk) {
-			make_obj(p->wk, &n->l, obj_bool);
-			set_obj_bool(p->wk, n->l, n->subtype);
-		}
 	} else if (accept(p, tok_false)) {
 		n = make_node(p, id, node_bool);
 		n->subtype = 0;
-		if (p->wk) {
-			make_obj(p->wk, &n->l, obj_bool);
-			set_obj_bool(p->wk, n->l, n->subtype);
-		}
 	} else if (accept(p, tok_identifier)) {
-		make_node(p, id, node_id);
+		n = make_node(p, id, node_id);
 	} else if (accept(p, tok_number)) {
 		n = make_node(p, id, node_number);
-		if (p->wk) {
-			make_obj(p->wk, &n->l, obj_number);
-			set_obj_number(p->wk, n->l, n->dat.n);
-		}
 	} else if (accept(p, tok_string)) {
 		n = make_node(p, id, node_string);
 		n->subtype = p->last_last->n;
-		if (p->wk) {
-			n->l = make_strn(p->wk, n->dat.s, n->subtype);
-		}
 	} else {
 		make_node(p, id, node_empty);
+		return true;
+	}
+
+	if (p->wk) {
+		node_init_value(p->wk, n);
 	}
 
 	return true;
@@ -560,11 +592,6 @@ parse_method_call(struct parser *p, uint32_t *id, uint32_t l_id, bool have_l)
 		return false;
 	}
 
-	struct node *args_n = get_node(p->ast, *id);
-	n = get_node(p->ast, *id);
-	args_n->line = n->line;
-	args_n->col = n->col;
-
 	n = get_node(p->ast, *id);
 	n->subtype = have_c;
 
@@ -715,15 +742,8 @@ parse_e7(struct parser *p, uint32_t *id)
 		add_child(p, p_id, node_child_l, l_id);
 		add_child(p, p_id, node_child_r, args);
 
-		struct node *n = get_node(p->ast, p_id),
-			    *func_name = get_node(p->ast, l_id);
-
-		n->line = func_name->line;
-		n->col = func_name->col;
-
-		n = get_node(p->ast, args);
-		n->line = args_start->line;
-		n->col = args_start->col;
+		*get_node_loc(p->ast, p_id) = *get_node_loc(p->ast, l_id);
+		*get_node_loc(p->ast, args) = (struct node_loc){ args_start->line, args_start->col };
 
 		if (!parse_chained(p, &d_id, 0, false)) {
 			return false;
@@ -1149,7 +1169,10 @@ parse_foreach_args(struct parser *p, uint32_t *id, uint32_t d)
 		return false;
 	}
 
-	make_node(p, &l_id, node_id);
+	struct node *n = make_node(p, &l_id, node_id);
+	if (p->wk) {
+		node_init_value(p->wk, n);
+	}
 
 	if (d <= 0 && accept(p, tok_comma)) {
 		have_r = true;
@@ -1300,9 +1323,7 @@ parse_line(struct parser *p, uint32_t *id)
 	p->caused_effect = caused_effect_old;
 
 	if (ret) {
-		struct node *res = get_node(p->ast, *id);
-		res->line = stmt_start->line;
-		res->col = stmt_start->col;
+		*get_node_loc(p->ast, *id) = (struct node_loc){ stmt_start->line, stmt_start->col };
 	}
 
 	return ret;
@@ -1384,9 +1405,11 @@ parser_parse(struct workspace *wk, struct ast *ast, struct source_data *sdata, s
 	};
 
 	darr_init(&ast->nodes, 2048, sizeof(struct node));
+	darr_init(&ast->locs, 2048, sizeof(struct node_loc));
 
 	if (mode & pm_keep_formatting) {
 		darr_init(&ast->comments, 2048, sizeof(char *));
+		darr_init(&ast->node_comments, 2048, sizeof(struct node_comments));
 	}
 
 	uint32_t id;
@@ -1412,5 +1435,7 @@ void
 ast_destroy(struct ast *ast)
 {
 	darr_destroy(&ast->nodes);
+	darr_destroy(&ast->locs);
 	darr_destroy(&ast->comments);
+	darr_destroy(&ast->node_comments);
 }
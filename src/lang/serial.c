@@ -5,6 +5,8 @@
 
 #include "compat.h"
 
+#include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "backend/output.h"
@@ -18,7 +20,37 @@
 
 #define SERIAL_MAGIC_LEN 8
 static const char serial_magic[SERIAL_MAGIC_LEN] = "muondump";
-static const uint32_t serial_version = 7;
+static const uint32_t serial_version = 10;
+
+/*
+ * A dump is a header followed by sections that are used in place when
+ * loading.  The file is mapped, the bucket arrays of a temporary workspace
+ * are pointed at the sections, and the requested object is cloned out of
+ * it.  This avoids reading and copying each object individually.
+ *
+ * Pointers are stored as offsets: struct str into the string data
+ * section, and struct obj_array into the array elements section.
+ * Sections are aligned to SERIAL_ALIGN, which is enough for the structs
+ * in them.
+ */
+enum serial_section {
+	serial_section_objs,
+	serial_section_str_data,
+	serial_section_array_elems,
+	serial_section_aos,
+	serial_section_count = serial_section_aos + (obj_type_count - _obj_aos_start),
+};
+
+#define SERIAL_ALIGN 16
+
+struct serial_header {
+	char magic[SERIAL_MAGIC_LEN];
+	uint32_t version;
+	obj root;
+	struct {
+		uint64_t off, len;
+	} sections[serial_section_count];
+};
 
 static bool
 corrupted_dump(void)
@@ -27,407 +59,631 @@ corrupted_dump(void)
 	return false;
 }
 
-
-static bool
-dump_uint32(uint32_t v, FILE *f)
+static uint64_t
+serial_align(uint64_t off)
 {
-	return fs_fwrite(&v, sizeof(uint32_t), f);
+	return (off + (SERIAL_ALIGN - 1)) & ~(uint64_t)(SERIAL_ALIGN - 1);
 }
 
+struct serial_writer {
+	FILE *f;
+	uint64_t off;
+};
+
 static bool
-dump_uint64(uint64_t v, FILE *f)
+serial_write(struct serial_writer *w, const void *data, uint64_t len)
 {
-	return fs_fwrite(&v, sizeof(uint64_t), f);
+	if (!len) {
+		return true;
+	}
+
+	w->off += len;
+	return fs_fwrite(data, len, w->f);
 }
 
 static bool
-load_uint32(uint32_t *v, FILE *f)
+serial_write_pad(struct serial_writer *w, uint64_t off)
 {
-	return fs_fread(v, sizeof(uint32_t), f);
+	static const uint8_t zero[SERIAL_ALIGN] = { 0 };
+	assert(off >= w->off && off - w->off < SERIAL_ALIGN);
+	return serial_write(w, zero, off - w->off);
 }
 
 static bool
-load_uint64(uint64_t *v, FILE *f)
+dump_bucket_array(struct serial_writer *w, const struct bucket_array *ba)
 {
-	return fs_fread(v, sizeof(uint64_t), f);
+	uint32_t i;
+	for (i = 0; i < ba->buckets.len; ++i) {
+		struct bucket *b = darr_get(&ba->buckets, i);
+		if (!serial_write(w, b->mem, (uint64_t)b->len * ba->item_size)) {
+			return false;
+		}
+	}
+
+	return true;
 }
 
 static bool
-dump_bucket_array(const struct bucket_array *ba, FILE *f)
+dump_section(struct workspace *wk, struct serial_writer *w, enum serial_section section)
 {
 	uint32_t i;
-
-	if (!dump_uint32(ba->buckets.len, f)) {
-		return false;
+	uint64_t off = 0;
+
+	switch (section) {
+	case serial_section_objs:
+		return dump_bucket_array(w, &wk->objs);
+	case serial_section_str_data: {
+		struct bucket_array *ba = &wk->obj_aos[obj_string - _obj_aos_start];
+		for (i = 0; i < ba->len; ++i) {
+			const struct str *ss = bucket_array_get(ba, i);
+			if (!(serial_write(w, ss->s, ss->len) && serial_write(w, "", 1))) {
+				return false;
+			}
+		}
+		return true;
+	}
+	case serial_section_array_elems: {
+		struct bucket_array *ba = &wk->obj_aos[obj_array - _obj_aos_start];
+		for (i = 0; i < ba->len; ++i) {
+			const struct obj_array *a = bucket_array_get(ba, i);
+			if (!serial_write(w, a->e, (uint64_t)a->len * sizeof(obj))) {
+				return false;
+			}
+		}
+		return true;
+	}
+	default:
+		break;
 	}
 
-	for (i = 0; i < ba->buckets.len; ++i) {
-		struct bucket *b = darr_get(&ba->buckets, i);
+	enum obj_type t = _obj_aos_start + (section - serial_section_aos);
+	struct bucket_array *ba = &wk->obj_aos[t - _obj_aos_start];
 
-		if (!dump_uint32(b->len, f)) {
-			return false;
+	switch (t) {
+	case obj_string:
+		for (i = 0; i < ba->len; ++i) {
+			struct str ss = *(struct str *)bucket_array_get(ba, i);
+			uint64_t len = ss.len + 1;
+			ss.s = (const char *)(uintptr_t)off;
+			ss.flags &= ~str_flag_big;
+			off += len;
+
+			if (!serial_write(w, &ss, sizeof(ss))) {
+				return false;
+			}
 		}
+		return true;
+	case obj_array:
+		for (i = 0; i < ba->len; ++i) {
+			struct obj_array a = *(struct obj_array *)bucket_array_get(ba, i);
+			uint32_t len = a.len;
+			a.e = (obj *)(uintptr_t)off;
+			a.cap = a.len;
+			a.flags &= ~obj_array_flag_big;
+			off += len;
+
+			if (!serial_write(w, &a, sizeof(a))) {
+				return false;
+			}
+		}
+		return true;
+	case obj_dict:
+		for (i = 0; i < ba->len; ++i) {
+			struct obj_dict d = *(struct obj_dict *)bucket_array_get(ba, i);
+			d.flags &= ~obj_dict_flag_hashed;
+			d.hash = 0;
 
-		if (!fs_fwrite(b->mem, ba->item_size * b->len, f)) {
-			return false;
+			if (!serial_write(w, &d, sizeof(d))) {
+				return false;
+			}
 		}
+		return true;
+	default:
+		return dump_bucket_array(w, ba);
 	}
-
-	return true;
 }
 
-static bool
-load_bucket_array(struct bucket_array *ba, FILE *f)
+static uint64_t
+section_len(struct workspace *wk, enum serial_section section)
 {
-	uint32_t buckets_len;
 	uint32_t i;
-	struct bucket b = { 0 };
-
-	assert(ba->len == 0);
+	uint64_t len = 0;
 
-	if (!load_uint32(&buckets_len, f)) {
-		return false;
+	switch (section) {
+	case serial_section_objs:
+		return (uint64_t)wk->objs.len * wk->objs.item_size;
+	case serial_section_str_data: {
+		struct bucket_array *ba = &wk->obj_aos[obj_string - _obj_aos_start];
+		for (i = 0; i < ba->len; ++i) {
+			len += ((struct str *)bucket_array_get(ba, i))->len + 1;
+		}
+		return len;
+	}
+	case serial_section_array_elems: {
+		struct bucket_array *ba = &wk->obj_aos[obj_array - _obj_aos_start];
+		for (i = 0; i < ba->len; ++i) {
+			len += ((struct obj_array *)bucket_array_get(ba, i))->len;
+		}
+		return len * sizeof(obj);
 	}
+	default: {
+		struct bucket_array *ba = &wk->obj_aos[section - serial_section_aos];
+		return (uint64_t)ba->len * ba->item_size;
+	}
+	}
+}
 
-	z_free(((struct bucket *)darr_get(&ba->buckets, 0))->mem);
-	darr_clear(&ba->buckets);
+bool
+serial_dump(struct workspace *wk_src, obj o, FILE *f)
+{
+	bool ret = false;
+	struct workspace wk = { 0 };
+	workspace_init_bare(&wk);
 
-	for (i = 0; i < buckets_len; ++i) {
-		init_bucket(ba, &b);
+	struct serial_header h = { .version = serial_version };
+	memcpy(h.magic, serial_magic, SERIAL_MAGIC_LEN);
 
-		if (!load_uint32(&b.len, f)) {
-			goto done;
-		}
+	if (!obj_clone(wk_src, &wk, o, &h.root)) {
+		goto ret;
+	}
 
-		if (b.len > ba->bucket_size) {
-			corrupted_dump();
-			goto done;
-		}
+	uint32_t i;
+	uint64_t off = serial_align(sizeof(h));
+	for (i = 0; i < serial_section_count; ++i) {
+		h.sections[i].off = off;
+		h.sections[i].len = section_len(&wk, i);
+		off = serial_align(off + h.sections[i].len);
+	}
 
-		ba->len += b.len;
+	struct serial_writer w = { .f = f };
+	if (!serial_write(&w, &h, sizeof(h))) {
+		goto ret;
+	}
 
-		if (!fs_fread(b.mem, ba->item_size * b.len, f)) {
-			goto done;
+	for (i = 0; i < serial_section_count; ++i) {
+		if (!serial_write_pad(&w, h.sections[i].off)) {
+			goto ret;
+		} else if (!dump_section(&wk, &w, i)) {
+			goto ret;
 		}
 
-		darr_push(&ba->buckets, &b);
-		continue;
-done:
-		z_free(b.mem);
-		return corrupted_dump();
+		assert(w.off == h.sections[i].off + h.sections[i].len);
 	}
 
-	return true;
+	ret = true;
+ret:
+	workspace_destroy_bare(&wk);
+	return ret;
 }
 
-static bool
-dump_serial_header(FILE *f)
-{
-	return fs_fwrite(serial_magic, SERIAL_MAGIC_LEN, f)
-	       && dump_uint32(serial_version, f);
-}
+struct serial_section_data {
+	uint8_t *data;
+	uint32_t len;
+};
 
 static bool
-load_serial_header(FILE *f)
+load_sections(struct workspace *wk, const struct fs_mapping *m, struct serial_header *h,
+	struct serial_section_data sections[serial_section_count])
 {
-	char buf[SERIAL_MAGIC_LEN] = { 0 };
-
-	if (!fs_fread(buf, SERIAL_MAGIC_LEN, f)) {
-		return false;
+	if (m->len < sizeof(*h)) {
+		return corrupted_dump();
 	}
 
-	if (memcmp(buf, serial_magic, SERIAL_MAGIC_LEN) != 0) {
+	memcpy(h, m->data, sizeof(*h));
+
+	if (memcmp(h->magic, serial_magic, SERIAL_MAGIC_LEN) != 0) {
 		LOG_E("invalid file (missing magic)");
 		return false;
-	}
-
-	uint32_t v;
-	if (!load_uint32(&v, f)) {
+	} else if (h->version != serial_version) {
+		LOG_E("unable to load data file created by a different version of muon (%d != %d)", h->version, serial_version);
 		return false;
 	}
 
-	if (v != serial_version) {
-		LOG_E("unable to load data file created by a different version of muon (%d != %d)", v, serial_version);
-		return false;
+	uint32_t i, item_size;
+	for (i = 0; i < serial_section_count; ++i) {
+		switch (i) {
+		case serial_section_objs:
+			item_size = wk->objs.item_size;
+			break;
+		case serial_section_str_data:
+			item_size = 1;
+			break;
+		case serial_section_array_elems:
+			item_size = sizeof(obj);
+			break;
+		default:
+			item_size = wk->obj_aos[i - serial_section_aos].item_size;
+			break;
+		}
+
+		if (h->sections[i].off % SERIAL_ALIGN
+		    || h->sections[i].off > m->len
+		    || h->sections[i].len > m->len - h->sections[i].off
+		    || h->sections[i].len % item_size
+		    || h->sections[i].len / item_size > UINT32_MAX) {
+			return corrupted_dump();
+		}
+
+		sections[i] = (struct serial_section_data) {
+			.data = m->data + h->sections[i].off,
+			.len = h->sections[i].len / item_size,
+		};
 	}
 
 	return true;
 }
 
+/*
+ * Turn the offsets stored by dump_section back into pointers, and check
+ * that every object refers to something that exists.
+ */
 static bool
-dump_big_strings(struct workspace *wk, struct darr *offsets, FILE *f)
+fixup_sections(struct workspace *wk, struct serial_section_data sections[serial_section_count])
 {
-	uint64_t len = 0;
-	uint64_t start, end;
+	uint32_t i;
+	struct serial_section_data *objs = &sections[serial_section_objs],
+				   *str_data = &sections[serial_section_str_data],
+				   *elems = &sections[serial_section_array_elems],
+				   *strs = &sections[serial_section_aos + obj_string - _obj_aos_start],
+				   *arrays = &sections[serial_section_aos + obj_array - _obj_aos_start],
+				   *dicts = &sections[serial_section_aos + obj_dict - _obj_aos_start];
 
-	// dump a placeholder at the start
-	if (!fs_ftell(f, &start)) {
-		return false;
-	} else if (!dump_uint64(0, f)) {
-		return false;
+	for (i = 0; i < objs->len; ++i) {
+		const struct obj_internal *o = (struct obj_internal *)objs->data + i;
+
+		if (o->t >= obj_type_count) {
+			return corrupted_dump();
+		} else if (o->t >= _obj_aos_start
+			   && o->val >= sections[serial_section_aos + o->t - _obj_aos_start].len) {
+			return corrupted_dump();
+		} else if (o->t == obj_file && o->val >= objs->len) {
+			return corrupted_dump();
+		}
 	}
 
-	uint32_t i;
-	struct bucket_array *str_ba = &wk->obj_aos[obj_string - _obj_aos_start];
-	for (i = 0; i < str_ba->len; ++i) {
-		struct str *ss = bucket_array_get(str_ba, i);
+	for (i = 0; i < strs->len; ++i) {
+		struct str *ss = (struct str *)strs->data + i;
+		uintptr_t off = (uintptr_t)ss->s;
 
-		if (!(ss->flags & str_flag_big)) {
-			continue;
+		if (off >= str_data->len || ss->len >= str_data->len - off
+		    || str_data->data[off + ss->len]) {
+			return corrupted_dump();
 		}
 
-		if (!fs_fwrite(ss->s, ss->len + 1, f)) {
-			return false;
+		ss->s = (const char *)&str_data->data[off];
+	}
+
+	for (i = 0; i < arrays->len; ++i) {
+		struct obj_array *a = (struct obj_array *)arrays->data + i;
+		uintptr_t off = (uintptr_t)a->e;
+
+		if (off > elems->len || a->len > elems->len - off) {
+			return corrupted_dump();
 		}
 
-		darr_push(offsets, &len);
-		len += ss->len + 1;
+		a->e = (obj *)elems->data + off;
 	}
 
-	// jump back to the beginning, write the length, and then return
-	if (!fs_ftell(f, &end)) {
-		return false;
-	} else if (!fs_fseek(f, start)) {
-		return false;
-	} else if (!dump_uint64(len, f)) {
-		return false;
-	} else if (!fs_fseek(f, end)) {
-		return false;
+	for (i = 0; i < elems->len; ++i) {
+		if (((obj *)elems->data)[i] >= objs->len) {
+			return corrupted_dump();
+		}
+	}
+
+	for (i = 0; i < dicts->len; ++i) {
+		struct obj_dict *d = (struct obj_dict *)dicts->data + i;
+		if (d->key >= objs->len || d->val >= objs->len || d->next >= objs->len || d->tail >= objs->len) {
+			return corrupted_dump();
+		}
 	}
 
 	return true;
 }
 
-struct big_string_table {
-	uint8_t *data;
-	uint64_t len;
-};
-
-static bool
-load_big_strings(struct workspace *wk, struct big_string_table *bst, FILE *f)
+/*
+ * Point ba at data without copying it.  Only full buckets are borrowed, a
+ * partial tail bucket is copied so that pushing to ba never writes past
+ * the end of data.
+ */
+static void
+borrow_bucket_array(struct bucket_array *ba, uint8_t *data, uint32_t len)
 {
-	uint64_t len;
-	uint8_t *buf = NULL;
-	if (!load_uint64(&len, f)) {
-		return false;
+	if (!len) {
+		return;
 	}
 
-	if (len) {
-		if (len > UINT32_MAX) {
-			return corrupted_dump();
-		}
+	z_free(((struct bucket *)darr_get(&ba->buckets, 0))->mem);
+	darr_clear(&ba->buckets);
 
-		buf = z_calloc(1, len);
-		if (!fs_fread(buf, len, f)) {
-			return false;
+	uint32_t i;
+	struct bucket b;
+	for (i = 0; i < len; i += b.len) {
+		b = (struct bucket) {
+			.mem = data + (uint64_t)i * ba->item_size,
+			.len = len - i < ba->bucket_size ? len - i : ba->bucket_size,
+		};
+
+		if (b.len < ba->bucket_size) {
+			uint8_t *mem = b.mem;
+			init_bucket(ba, &b);
+			memcpy(b.mem, mem, (uint64_t)b.len * ba->item_size);
 		}
+
+		darr_push(&ba->buckets, &b);
+	}
+
+	if (b.len == ba->bucket_size) {
+		b = (struct bucket) { 0 };
+		init_bucket(ba, &b);
+		darr_push(&ba->buckets, &b);
 	}
 
-	*bst = (struct big_string_table){
-		.data = buf,
-		.len = len,
-	};
+	ba->len = len;
+	ba->tail_bucket = ba->buckets.len - 1;
+}
 
-	return true;
+static void
+release_bucket_array(struct bucket_array *ba)
+{
+	uint32_t i, borrowed = ba->len / ba->bucket_size;
+	for (i = borrowed; i < ba->buckets.len; ++i) {
+		z_free(((struct bucket *)darr_get(&ba->buckets, i))->mem);
+	}
+
+	darr_destroy(&ba->buckets);
+	bucket_array_init(ba, ba->bucket_size, ba->item_size);
 }
 
-struct serial_str {
+/*
+ * Dumps in the previous format, version 7, are still loaded so that
+ * existing build directories keep working.  That format stores each
+ * object in turn, and arrays as linked lists of array objects, which are
+ * turned back into plain arrays here.
+ */
+static const uint32_t serial_version_v7 = 7;
+
+struct serial_v7_reader {
+	const uint8_t *data;
+	uint64_t len, off;
+};
+
+struct serial_v7_str {
 	uint64_t s, len;
 	enum str_flags flags;
 };
 
+struct serial_v7_array {
+	obj val, next, tail;
+	uint32_t len;
+	bool have_next;
+};
+
+struct serial_v7_dict {
+	obj key, val, next, tail;
+	uint32_t len;
+	bool have_next;
+};
+
 static bool
-get_big_string(struct workspace *wk, const struct big_string_table *bst, struct serial_str *src, struct str *res)
+v7_read(struct serial_v7_reader *r, void *dst, uint64_t len)
 {
-	assert(src->flags & str_flag_big);
-
-	if (src->s >= bst->len) {
+	if (len > r->len - r->off) {
 		return corrupted_dump();
 	}
 
-	char *buf = z_calloc(1, src->len + 1);
-	memcpy(buf, &bst->data[src->s], src->len);
-
-	*res = (struct str) {
-		.flags = src->flags,
-		.len = src->len,
-		.s = buf,
-	};
-
+	memcpy(dst, &r->data[r->off], len);
+	r->off += len;
 	return true;
 }
 
 static bool
-dump_objs(struct workspace *wk, struct darr *big_string_offsets, FILE *f)
+v7_read_uint32(struct serial_v7_reader *r, uint32_t *v)
 {
-	if (!dump_uint32(wk->objs.len - 1, f)) {
-		return false;
-	}
+	return v7_read(r, v, sizeof(uint32_t));
+}
 
-	struct serial_str ser_s;
-	// memsan is upset about uninitialized padding bytes in this struct
-	// when we try to write it out.  A better solution would be to not
-	// write the padding bytes to disk, but that would complicate the code.
-	memset(&ser_s, 0, sizeof(struct serial_str));
+static bool
+v7_load_chrs(struct serial_v7_reader *r, struct bucket_array *ba)
+{
+	uint32_t buckets_len, i;
+	struct bucket b;
 
-	void *data;
-	size_t len;
-	uint8_t type_tag;
+	if (!v7_read_uint32(r, &buckets_len)) {
+		return false;
+	}
 
-	assert(obj_type_count < UINT8_MAX && "increase size of type tag");
+	z_free(((struct bucket *)darr_get(&ba->buckets, 0))->mem);
+	darr_clear(&ba->buckets);
 
-	uint32_t i, big_string_i = 0;
-	for (i = 1; i < wk->objs.len; ++i) {
-		struct obj_internal *o = bucket_array_get(&wk->objs, i);
-		type_tag = o->t;
+	for (i = 0; i < buckets_len; ++i) {
+		init_bucket(ba, &b);
+		darr_push(&ba->buckets, &b);
 
-		if (!fs_fwrite(&type_tag, sizeof(uint8_t), f)) {
+		if (!v7_read_uint32(r, &b.len)) {
+			return false;
+		} else if (b.len > ba->bucket_size) {
+			return corrupted_dump();
+		} else if (!v7_read(r, b.mem, b.len)) {
 			return false;
 		}
 
-		if (o->t == obj_string) {
-			const struct str *ss =
-				bucket_array_get(&wk->obj_aos[obj_string - _obj_aos_start], o->val);
+		((struct bucket *)darr_get(&ba->buckets, i))->len = b.len;
+		ba->len += b.len;
+	}
 
-			ser_s = (struct serial_str) {
-				.len = ss->len,
-				.flags = ss->flags,
-			};
+	if (!buckets_len) {
+		init_bucket(ba, &b);
+		darr_push(&ba->buckets, &b);
+	}
 
-			if (ss->flags & str_flag_big) {
-				ser_s.s = *(uint64_t *)darr_get(big_string_offsets, big_string_i);
-				++big_string_i;
-			} else {
-				if (!bucket_array_lookup_pointer(&wk->chrs, (uint8_t *)ss->s, &ser_s.s)) {
-					assert(false && "pointer not found");
-				}
-			}
+	ba->tail_bucket = ba->buckets.len - 1;
+	return true;
+}
 
-			data = &ser_s;
-			len = sizeof(struct serial_str);
-		} else if (o->t < _obj_aos_start) {
-			data = &o->val;
-			len = sizeof(uint32_t);
-		} else {
-			struct bucket_array *ba = &wk->obj_aos[o->t - _obj_aos_start];
-			data = bucket_array_get(ba, o->val);
-			len = ba->item_size;
+static bool
+v7_load_str(struct workspace *wk, struct serial_v7_reader *r, const uint8_t *big, uint64_t big_len, struct str *ss)
+{
+	struct serial_v7_str ser_s;
+	if (!v7_read(r, &ser_s, sizeof(ser_s))) {
+		return false;
+	}
+
+	if (ser_s.flags & str_flag_big) {
+		if (ser_s.s > big_len || ser_s.len >= big_len - ser_s.s) {
+			return corrupted_dump();
 		}
 
-		if (!fs_fwrite(data, len, f)) {
-			return false;
+		char *buf = z_calloc(1, ser_s.len + 1);
+		memcpy(buf, &big[ser_s.s], ser_s.len);
+		*ss = (struct str) { .s = buf, .len = ser_s.len, .flags = str_flag_big };
+	} else {
+		/* offsets are bucket index * bucket size + offset in the bucket */
+		uint64_t bucket_i = ser_s.s / wk->chrs.bucket_size, off = ser_s.s % wk->chrs.bucket_size;
+		if (bucket_i >= wk->chrs.buckets.len) {
+			return corrupted_dump();
 		}
+
+		const struct bucket *b = darr_get(&wk->chrs.buckets, bucket_i);
+		if (off >= b->len || ser_s.len >= b->len - off) {
+			return corrupted_dump();
+		}
+
+		*ss = (struct str) { .s = bucket_array_get(&wk->chrs, ser_s.s), .len = ser_s.len };
 	}
 
 	return true;
 }
 
 static bool
-load_objs(struct workspace *wk, const struct big_string_table *bst, FILE *f)
+serial_load_v7(struct workspace *wk, obj *res, const struct fs_mapping *m)
 {
-	uint32_t len;
-	if (!load_uint32(&len, f)) {
-		return false;
+	bool ret = false;
+	struct serial_v7_reader r = { .data = m->data, .len = m->len, .off = SERIAL_MAGIC_LEN + sizeof(uint32_t) };
+	struct serial_v7_array *arrays = NULL;
+	uint64_t big_len;
+	const uint8_t *big;
+	obj root;
+	uint32_t len, i;
+
+	struct workspace wk_src = { 0 };
+	workspace_init_bare(&wk_src);
+
+	if (!v7_read_uint32(&r, &root)) {
+		goto ret;
+	} else if (!v7_load_chrs(&r, &wk_src.chrs)) {
+		goto ret;
+	} else if (!v7_read(&r, &big_len, sizeof(big_len))) {
+		goto ret;
+	} else if (big_len > r.len - r.off) {
+		corrupted_dump();
+		goto ret;
 	}
 
-	if (!len) {
-		return true;
+	big = &r.data[r.off];
+	r.off += big_len;
+
+	if (!v7_read_uint32(&r, &len)) {
+		goto ret;
+	} else if (len >= UINT32_MAX - wk_src.objs.len) {
+		corrupted_dump();
+		goto ret;
 	}
 
-	uint8_t type_tag;
-	struct serial_str ser_s;
-	struct bucket_array *ba;
+	/* array objects are read into this, indexed by object id, and
+	 * converted once everything they point to is loaded */
+	arrays = z_calloc((uint64_t)wk_src.objs.len + len, sizeof(struct serial_v7_array));
 
-	uint32_t i;
 	for (i = 0; i < len; ++i) {
-		if (!fs_fread(&type_tag, sizeof(uint8_t), f)) {
-			return false;
+		uint8_t t;
+		if (!v7_read(&r, &t, sizeof(t))) {
+			goto ret;
+		} else if (t >= obj_type_count) {
+			corrupted_dump();
+			goto ret;
 		}
 
-		bucket_array_pushn(&wk->objs, NULL, 0, 1);
-		struct obj_internal *o = bucket_array_get(&wk->objs, wk->objs.len - 1);
-
-		*o = (struct obj_internal) { .t = type_tag, };
+		obj id = wk_src.objs.len;
+		bucket_array_pushn(&wk_src.objs, NULL, 0, 1);
+		struct obj_internal *o = bucket_array_get(&wk_src.objs, id);
+		*o = (struct obj_internal) { .t = t };
 
-		if (type_tag < _obj_aos_start) {
-			if (!fs_fread(&o->val, sizeof(uint32_t), f)) {
-				return false;
+		if (t < _obj_aos_start) {
+			if (!v7_read_uint32(&r, &o->val)) {
+				goto ret;
 			}
 			continue;
 		}
 
-		if (type_tag >= obj_type_count) {
-			return corrupted_dump();
-		}
-
-		ba = &wk->obj_aos[type_tag - _obj_aos_start];
+		struct bucket_array *ba = &wk_src.obj_aos[t - _obj_aos_start];
 		o->val = ba->len;
 		bucket_array_pushn(ba, NULL, 0, 1);
+		void *dest = bucket_array_get(ba, o->val);
 
-		if (type_tag == obj_string) {
-			if (!fs_fread(&ser_s, sizeof(struct serial_str), f)) {
-				return false;
+		switch (t) {
+		case obj_string:
+			if (!v7_load_str(&wk_src, &r, big, big_len, dest)) {
+				goto ret;
 			}
-
-			struct str *ss = bucket_array_get(ba, o->val);
-
-			if (ser_s.flags & str_flag_big) {
-				if (!get_big_string(wk, bst, &ser_s, ss)) {
-					return false;
-				}
-			} else {
-				uint32_t bucket_i = ser_s.s % wk->chrs.bucket_size,
-					 buckets_i = ser_s.s / wk->chrs.bucket_size;
-				if (buckets_i > wk->chrs.buckets.len
-				    || bucket_i > ((struct bucket *)(darr_get(&wk->chrs.buckets, buckets_i)))->len) {
-					return corrupted_dump();
-				}
-
-				*ss = (struct str){
-					.s = bucket_array_get(&wk->chrs, ser_s.s),
-					.len = ser_s.len,
-					.flags = ser_s.flags,
-				};
+			break;
+		case obj_array:
+			if (!v7_read(&r, &arrays[id], sizeof(struct serial_v7_array))) {
+				goto ret;
 			}
-		} else {
-			if (!fs_fread(bucket_array_get(ba, o->val), ba->item_size, f)) {
-				return false;
+			break;
+		case obj_dict: {
+			struct serial_v7_dict d;
+			if (!v7_read(&r, &d, sizeof(d))) {
+				goto ret;
 			}
+
+			*(struct obj_dict *)dest = (struct obj_dict) {
+				.key = d.key, .val = d.val, .next = d.next, .tail = d.tail,
+				.len = d.len, .have_next = d.have_next,
+			};
+			break;
+		}
+		default:
+			if (!v7_read(&r, dest, ba->item_size)) {
+				goto ret;
+			}
+			break;
 		}
 	}
 
-	return true;
-}
+	for (i = 0; i < wk_src.objs.len; ++i) {
+		uint32_t j;
+		obj node = i;
 
-bool
-serial_dump(struct workspace *wk_src, obj o, FILE *f)
-{
-	bool ret = false;
-	struct workspace wk_dest = { 0 };
-	workspace_init_bare(&wk_dest);
+		if (get_obj_type(&wk_src, i) != obj_array) {
+			continue;
+		}
 
-	struct darr big_string_offsets;
-	darr_init(&big_string_offsets, 32, sizeof(uint64_t));
+		for (j = 0; j < arrays[i].len; ++j) {
+			if (node >= wk_src.objs.len || get_obj_type(&wk_src, node) != obj_array) {
+				corrupted_dump();
+				goto ret;
+			}
 
-	obj obj_dest;
-	if (!obj_clone(wk_src, &wk_dest, o, &obj_dest)) {
-		goto ret;
-	}
+			obj_array_push(&wk_src, i, arrays[node].val);
 
-	/* obj_fprintf(&wk_dest, log_file(), "saving %o\n", obj_dest); */
+			if (!arrays[node].have_next) {
+				break;
+			}
+			node = arrays[node].next;
+		}
+	}
 
-	if (!(dump_serial_header(f)
-	      && dump_uint32(obj_dest, f)
-	      && dump_bucket_array(&wk_dest.chrs, f)
-	      && dump_big_strings(&wk_dest, &big_string_offsets, f)
-	      && dump_objs(&wk_dest, &big_string_offsets, f))) {
+	if (root >= wk_src.objs.len || !obj_clone(&wk_src, wk, root, res)) {
+		corrupted_dump();
 		goto ret;
 	}
 
 	ret = true;
 ret:
-	workspace_destroy_bare(&wk_dest);
-	darr_destroy(&big_string_offsets);
+	if (arrays) {
+		z_free(arrays);
+	}
+	workspace_destroy_bare(&wk_src);
 	return ret;
 }
 
@@ -435,32 +691,48 @@ bool
 serial_load(struct workspace *wk, obj *res, FILE *f)
 {
 	bool ret = false;
+	struct fs_mapping m;
+	struct serial_header h;
+	struct serial_section_data sections[serial_section_count];
+	uint32_t i;
+
 	struct workspace wk_src = { 0 };
 	workspace_init_bare(&wk_src);
 
-	struct big_string_table bst = { 0 };
-
-	obj obj_src;
-	if (!(load_serial_header(f)
-	      && load_uint32(&obj_src, f)
-	      && load_bucket_array(&wk_src.chrs, f)
-	      && load_big_strings(&wk_src, &bst, f)
-	      && load_objs(&wk_src, &bst, f))) {
+	if (!fs_map(f, &m)) {
+		goto ret;
+	} else if (m.len >= SERIAL_MAGIC_LEN + sizeof(uint32_t)
+		   && memcmp(m.data, serial_magic, SERIAL_MAGIC_LEN) == 0
+		   && memcmp(&m.data[SERIAL_MAGIC_LEN], &serial_version_v7, sizeof(uint32_t)) == 0) {
+		ret = serial_load_v7(wk, res, &m);
+		goto ret;
+	} else if (!load_sections(&wk_src, &m, &h, sections)) {
+		goto ret;
+	} else if (!fixup_sections(&wk_src, sections)) {
+		goto ret;
+	} else if (!sections[serial_section_objs].len || h.root >= sections[serial_section_objs].len) {
+		corrupted_dump();
 		goto ret;
 	}
 
-	/* obj_fprintf(&wk_src, log_file(), "loaded %o\n", obj_src); */
+	borrow_bucket_array(&wk_src.objs, sections[serial_section_objs].data, sections[serial_section_objs].len);
+	for (i = _obj_aos_start; i < obj_type_count; ++i) {
+		struct serial_section_data *s = &sections[serial_section_aos + i - _obj_aos_start];
+		borrow_bucket_array(&wk_src.obj_aos[i - _obj_aos_start], s->data, s->len);
+	}
 
-	if (!obj_clone(&wk_src, wk, obj_src, res)) {
+	if (!obj_clone(&wk_src, wk, h.root, res)) {
 		corrupted_dump();
-		goto ret;
+	} else {
+		ret = true;
 	}
 
-	ret = true;
-ret:
-	if (bst.data) {
-		z_free(bst.data);
+	release_bucket_array(&wk_src.objs);
+	for (i = _obj_aos_start; i < obj_type_count; ++i) {
+		release_bucket_array(&wk_src.obj_aos[i - _obj_aos_start]);
 	}
+ret:
+	fs_unmap(&m);
 	workspace_destroy_bare(&wk_src);
 	return ret;
 }
@@ -66,11 +66,17 @@ get_cstr(struct workspace *wk, obj s)
 }
 
 static struct str *
-grow_str(struct workspace *wk, obj s, uint32_t grow_by, bool alloc_nul)
+grow_str(struct workspace *wk, obj *s, uint32_t grow_by, bool alloc_nul)
 {
-	assert(s);
+	assert(*s);
+
+	struct str *ss = (struct str *)get_str(wk, *s);
+	if (ss->flags & str_flag_interned) {
+		/* interned strings are shared, so grow a copy instead */
+		*s = make_strn(wk, ss->s, ss->len);
+		ss = (struct str *)get_str(wk, *s);
+	}
 
-	struct str *ss = (struct str *)get_str(wk, s);
 	uint32_t new_len = ss->len + grow_by;
 
 	if (alloc_nul) {
@@ -146,6 +152,42 @@ make_str(struct workspace *wk, const char *str)
 	return _make_str(wk, str, strlen(str));
 }
 
+/*
+ * Interned strings are deduplicated through wk->interned_strs, so two interned
+ * strings are equal iff they are the same object.  They must never be
+ * modified in place.  This is only worth it for strings that are created over
+ * and over with the same contents, e.g. string literals and compiler flags.
+ *
+ * Hashes are not cached in struct str.  Adding one would grow every string,
+ * interned or not, from 16 to 24 bytes, which costs more than interning
+ * saves.  Interning has to hash the incoming bytes before any object exists
+ * anyway, and interned strings compare by id afterwards, so a cached hash
+ * would only help lookups in hashed dicts, which store the hash of every
+ * key they index already.
+ */
+obj
+make_strn_interned(struct workspace *wk, const char *str, uint32_t n)
+{
+	uint64_t *v;
+	struct str key = { .s = str, .len = n };
+
+	if ((v = hash_get(&wk->interned_strs, &key))) {
+		return *v;
+	}
+
+	obj s = make_strn(wk, str, n);
+	struct str *ss = (struct str *)get_str(wk, s);
+	ss->flags |= str_flag_interned;
+	hash_set(&wk->interned_strs, ss, s);
+	return s;
+}
+
+obj
+make_str_interned(struct workspace *wk, const char *str)
+{
+	return make_strn_interned(wk, str, strlen(str));
+}
+
 obj
 make_strf(struct workspace *wk, const char *fmt, ...)
 {
@@ -172,7 +214,7 @@ make_strf(struct workspace *wk, const char *fmt, ...)
 }
 
 void
-str_appn(struct workspace *wk, obj s, const char *str, uint32_t n)
+str_appn(struct workspace *wk, obj *s, const char *str, uint32_t n)
 {
 	struct str *ss = grow_str(wk, s, n, true);
 	memcpy((char *)&ss->s[ss->len], str, n);
@@ -180,13 +222,13 @@ str_appn(struct workspace *wk, obj s, const char *str, uint32_t n)
 }
 
 void
-str_app(struct workspace *wk, obj s, const char *str)
+str_app(struct workspace *wk, obj *s, const char *str)
 {
 	str_appn(wk, s, str, strlen(str));
 }
 
 void
-str_appf(struct workspace *wk, obj s, const char *fmt, ...)
+str_appf(struct workspace *wk, obj *s, const char *fmt, ...)
 {
 	uint32_t len;
 	va_list args, args_copy;
@@ -195,7 +237,7 @@ str_appf(struct workspace *wk, obj s, const char *fmt, ...)
 
 	len = vsnprintf(NULL, 0, fmt, args_copy);
 
-	uint32_t olen = get_str(wk, s)->len;
+	uint32_t olen = get_str(wk, *s)->len;
 	struct str *ss = grow_str(wk, s, len, true);
 
 	/* obj_vsnprintf(wk, (char *)ss->s, len + 1, fmt, args); */
@@ -213,6 +255,40 @@ str_clone(struct workspace *wk_src, struct workspace *wk_dest, obj val)
 	return make_strn(wk_dest, ss->s, ss->len);
 }
 
+uint64_t
+str_hash(const struct str *ss)
+{
+	uint64_t h = 14695981039346656037u;
+	uint32_t i;
+
+	for (i = 0; i < ss->len; ++i) {
+		h ^= (uint8_t)ss->s[i];
+		h *= 1099511628211u;
+	}
+
+	return h;
+}
+
+static uint64_t
+str_intern_table_hash(const struct hash *h, const void *k)
+{
+	return str_hash(k);
+}
+
+static bool
+str_intern_table_keycmp(const struct hash *h, const void *a, const void *b)
+{
+	return str_eql(a, b);
+}
+
+void
+str_intern_table_init(struct hash *h)
+{
+	hash_init(h, 1024, sizeof(struct str));
+	h->hash_func = str_intern_table_hash;
+	h->keycmp = str_intern_table_keycmp;
+}
+
 bool
 str_eql(const struct str *ss1, const struct str *ss2)
 {
@@ -451,7 +527,7 @@ sbuf_grow(struct workspace *wk, struct sbuf *sb, uint32_t inc)
 			sb->buf = z_realloc(sb->buf, newcap);
 			memset((void *)&sb->buf[sb->len], 0, newcap - sb->cap);
 		} else {
-			grow_str(wk, sb->s, newcap - sb->cap, false);
+			grow_str(wk, &sb->s, newcap - sb->cap, false);
 			struct str *ss = (struct str *)get_str(wk, sb->s);
 			sb->buf = (char *)ss->s;
 			ss->len = newcap;
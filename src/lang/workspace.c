@@ -16,21 +16,126 @@
 #include "platform/mem.h"
 #include "platform/path.h"
 
+/*
+ * Every identifier is assigned a symbol id the first time it is seen.  For
+ * identifiers in source files this happens at parse time, and the id is
+ * stored in the node's l field.  Scopes are then arrays of variables indexed
+ * by symbol id.  Symbol 0 is reserved so that l == 0 means unresolved.
+ */
+
+struct scope_var {
+	obj val;
+	bool set;
+};
+
+uint32_t
+symbol_id(struct workspace *wk, const char *name)
+{
+	uint64_t *v;
+	if ((v = hash_get_str(&wk->symbols, name))) {
+		return *v;
+	}
+
+	uint32_t len = strlen(name);
+	char *s = z_malloc(len + 1);
+	memcpy(s, name, len + 1);
+
+	uint32_t sym = darr_push(&wk->symbol_names, &s);
+	hash_set_str(&wk->symbols, s, sym);
+	return sym;
+}
+
 bool
-get_obj_id(struct workspace *wk, const char *name, obj *res, uint32_t proj_id)
+symbol_lookup(struct workspace *wk, const char *name, uint32_t *sym)
 {
-	uint64_t *idp;
-	struct project *proj = darr_get(&wk->projects, proj_id);
+	uint64_t *v;
+	if (!(v = hash_get_str(&wk->symbols, name))) {
+		return false;
+	}
 
-	if ((idp = hash_get_str(&proj->scope, name))) {
-		*res = *idp;
-		return true;
-	} else if ((idp = hash_get_str(&wk->scope, name))) {
-		*res = *idp;
-		return true;
-	} else {
+	*sym = *v;
+	return true;
+}
+
+const char *
+symbol_name(struct workspace *wk, uint32_t sym)
+{
+	return *(const char **)darr_get(&wk->symbol_names, sym);
+}
+
+bool
+scope_get_sym(struct darr *scope, uint32_t sym, obj *res)
+{
+	if (sym >= scope->len) {
 		return false;
 	}
+
+	struct scope_var *v = darr_get(scope, sym);
+	if (!v->set) {
+		return false;
+	}
+
+	*res = v->val;
+	return true;
+}
+
+void
+scope_set_sym(struct darr *scope, uint32_t sym, obj val)
+{
+	if (sym >= scope->len) {
+		uint32_t len = scope->len;
+		darr_grow_by(scope, sym + 1 - len);
+		memset(darr_get(scope, len), 0, (sym + 1 - len) * scope->item_size);
+	}
+
+	*(struct scope_var *)darr_get(scope, sym) = (struct scope_var) { .val = val, .set = true };
+}
+
+void
+scope_unset_sym(struct darr *scope, uint32_t sym)
+{
+	if (sym < scope->len) {
+		((struct scope_var *)darr_get(scope, sym))->set = false;
+	}
+}
+
+bool
+scope_get(struct workspace *wk, struct darr *scope, const char *name, obj *res)
+{
+	uint32_t sym;
+	return symbol_lookup(wk, name, &sym) && scope_get_sym(scope, sym, res);
+}
+
+void
+scope_set(struct workspace *wk, struct darr *scope, const char *name, obj val)
+{
+	scope_set_sym(scope, symbol_id(wk, name), val);
+}
+
+void
+scope_unset(struct workspace *wk, struct darr *scope, const char *name)
+{
+	uint32_t sym;
+	if (symbol_lookup(wk, name, &sym)) {
+		scope_unset_sym(scope, sym);
+	}
+}
+
+bool
+get_obj_id_sym(struct workspace *wk, uint32_t sym, obj *res, uint32_t proj_id)
+{
+	struct project *proj = darr_get(&wk->projects, proj_id);
+
+	return scope_get_sym(&proj->scope, sym, res)
+	       || scope_get_sym(&wk->scope, sym, res);
+}
+
+bool
+get_obj_id(struct workspace *wk, const char *name, obj *res, uint32_t proj_id)
+{
+	uint32_t sym;
+	return symbol_lookup(wk, name, &sym)
+	       && get_obj_id_sym(wk, sym, res, proj_id);
 }
 
 struct project *
@@ -40,7 +145,7 @@ make_project(struct workspace *wk, uint32_t *id, const char *subproject_name,
 	*id = darr_push(&wk->projects, &(struct project){ 0 });
 	struct project *proj = darr_get(&wk->projects, *id);
 
-	hash_init_str(&proj->scope, 128);
+	darr_init(&proj->scope, 128, sizeof(struct scope_var));
 
 	make_obj(wk, &proj->args, obj_dict);
 	make_obj(wk, &proj->compilers, obj_dict);
@@ -100,6 +205,7 @@ workspace_init_bare(struct workspace *wk)
 #endif
 
 	bucket_array_init(&wk->chrs, 4096, 1);
+	bucket_array_init(&wk->array_elems, 4096, sizeof(obj));
 	bucket_array_init(&wk->objs, 1024, sizeof(struct obj_internal));
 
 	const struct {
@@ -139,11 +245,18 @@ workspace_init_bare(struct workspace *wk)
 		bucket_array_init(&wk->obj_aos[i - _obj_aos_start], sizes[i].bucket_size, sizes[i].item_size);
 	}
 
+	darr_init(&wk->dict_hashes, 16, sizeof(struct obj_dict_hash));
+
 	obj id;
 	make_obj(wk, &id, obj_null);
 	assert(id == 0);
 
 	hash_init(&wk->obj_hash, 128, sizeof(obj));
+	str_intern_table_init(&wk->interned_strs);
+
+	hash_init_str(&wk->symbols, 256);
+	darr_init(&wk->symbol_names, 256, sizeof(char *));
+	darr_push(&wk->symbol_names, &(char *){ NULL });
 }
 
 void
@@ -153,6 +266,7 @@ workspace_init(struct workspace *wk)
 
 	wk->argv0 = "dummy";
 	wk->build_root = "dummy";
+	wk->compiler_check_jobs = 4;
 
 	obj id;
 	make_obj(wk, &id, obj_disabler);
@@ -165,19 +279,20 @@ workspace_init(struct workspace *wk)
 	darr_init(&wk->projects, 16, sizeof(struct project));
 	darr_init(&wk->option_overrides, 32, sizeof(struct option_override));
 	darr_init(&wk->source_data, 4, sizeof(struct source_data));
-	hash_init_str(&wk->scope, 32);
+	darr_init(&wk->scope, 32, sizeof(struct scope_var));
 
 	make_obj(wk, &id, obj_meson);
-	hash_set_str(&wk->scope, "meson", id);
+	scope_set(wk, &wk->scope, "meson", id);
 
 	make_obj(wk, &id, obj_machine);
-	hash_set_str(&wk->scope, "host_machine", id);
-	hash_set_str(&wk->scope, "build_machine", id);
-	hash_set_str(&wk->scope, "target_machine", id);
+	scope_set(wk, &wk->scope, "host_machine", id);
+	scope_set(wk, &wk->scope, "build_machine", id);
+	scope_set(wk, &wk->scope, "target_machine", id);
 
 	make_obj(wk, &wk->binaries, obj_dict);
 	make_obj(wk, &wk->host_machine, obj_dict);
 	make_obj(wk, &wk->regenerate_deps, obj_array);
+	make_obj(wk, &wk->regenerate_queries, obj_dict);
 	make_obj(wk, &wk->install, obj_array);
 	make_obj(wk, &wk->install_scripts, obj_array);
 	make_obj(wk, &wk->postconf_scripts, obj_array);
@@ -189,6 +304,7 @@ workspace_init(struct workspace *wk)
 	make_obj(wk, &wk->find_program_overrides, obj_dict);
 	make_obj(wk, &wk->global_opts, obj_dict);
 	make_obj(wk, &wk->compiler_check_cache, obj_dict);
+	make_obj(wk, &wk->compiler_check_shared, obj_dict);
 
 	if (!init_global_options(wk)) {
 		UNREACHABLE;
@@ -198,6 +314,9 @@ workspace_init(struct workspace *wk)
 void
 workspace_destroy_bare(struct workspace *wk)
 {
+	dir_cache_destroy(wk);
+	ast_cache_destroy(wk);
+
 	bucket_array_destroy(&wk->chrs);
 
 	bucket_array_destroy(&wk->objs);
@@ -211,11 +330,31 @@ workspace_destroy_bare(struct workspace *wk)
 		}
 	}
 
+	struct bucket_array *arr_ba = &wk->obj_aos[obj_array - _obj_aos_start];
+	for (i = 0; i < arr_ba->len; ++i) {
+		struct obj_array *a = bucket_array_get(arr_ba, i);
+		if (a->flags & obj_array_flag_big) {
+			z_free(a->e);
+		}
+	}
+
+	bucket_array_destroy(&wk->array_elems);
+
 	for (i = _obj_aos_start; i < obj_type_count; ++i) {
 		bucket_array_destroy(&wk->obj_aos[i - _obj_aos_start]);
 	}
 
+	obj_dict_hashes_destroy(wk, 0);
+	darr_destroy(&wk->dict_hashes);
+
 	hash_destroy(&wk->obj_hash);
+	hash_destroy(&wk->interned_strs);
+
+	for (i = 1; i < wk->symbol_names.len; ++i) {
+		z_free(*(char **)darr_get(&wk->symbol_names, i));
+	}
+	darr_destroy(&wk->symbol_names);
+	hash_destroy(&wk->symbols);
 }
 
 void
@@ -226,7 +365,7 @@ workspace_destroy(struct workspace *wk)
 	for (i = 0; i < wk->projects.len; ++i) {
 		proj = darr_get(&wk->projects, i);
 
-		hash_destroy(&proj->scope);
+		darr_destroy(&proj->scope);
 	}
 
 	for (i = 0; i < wk->source_data.len; ++i) {
@@ -238,7 +377,7 @@ workspace_destroy(struct workspace *wk)
 	darr_destroy(&wk->projects);
 	darr_destroy(&wk->option_overrides);
 	darr_destroy(&wk->source_data);
-	hash_destroy(&wk->scope);
+	darr_destroy(&wk->scope);
 
 	workspace_destroy_bare(wk);
 }
@@ -355,7 +494,7 @@ workspace_add_regenerate_deps_iter(struct workspace *wk, void *_ctx, obj v)
 		return ir_cont;
 	}
 
-	if (!fs_file_exists(s)) {
+	if (!fs_file_exists(s) && !fs_dir_exists(s)) {
 		return ir_cont;
 	}
 
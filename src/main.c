@@ -7,11 +7,13 @@
 
 #include "compat.h"
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "args.h"
 #include "backend/backend.h"
+#include "data/darr.h"
 #include "cmd_install.h"
 #include "cmd_test.h"
 #include "embedded.h"
@@ -20,6 +22,7 @@
 #include "external/libpkgconf.h"
 #include "external/samurai.h"
 #include "functions/common.h"
+#include "functions/compiler.h"
 #include "lang/analyze.h"
 #include "lang/fmt.h"
 #include "lang/interpreter.h"
@@ -28,6 +31,7 @@
 #include "meson_opts.h"
 #include "options.h"
 #include "opts.h"
+#include "platform/filesystem.h"
 #include "platform/init.h"
 #include "platform/mem.h"
 #include "platform/path.h"
@@ -417,6 +421,7 @@ ret:
 
 struct cmd_subprojects_download_ctx {
 	const char *subprojects;
+	struct darr wrap_files;
 };
 
 static enum iteration_result
@@ -436,13 +441,9 @@ cmd_subprojects_download_iter(void *_ctx, const char *name)
 		goto cont;
 	}
 
-	LOG_I("fetching %s", name);
-	struct wrap wrap = { 0 };
-	if (!wrap_handle(path.buf, ctx->subprojects, &wrap, true)) {
-		goto cont;
-	}
-
-	wrap_destroy(&wrap);
+	char *wrap_file = z_malloc(path.len + 1);
+	memcpy(wrap_file, path.buf, path.len + 1);
+	darr_push(&ctx->wrap_files, &wrap_file);
 cont:
 	sbuf_destroy(&path);
 	return ir_cont;
@@ -452,6 +453,7 @@ static bool
 cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 {
 	bool res = false;
+	uint32_t i;
 
 	OPTSTART("") {
 	} OPTEND(argv[argi], " <list of subprojects>", "", NULL, -1)
@@ -462,6 +464,7 @@ cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 	struct cmd_subprojects_download_ctx ctx = {
 		.subprojects = path.buf,
 	};
+	darr_init(&ctx.wrap_files, 8, sizeof(char *));
 
 	if (argc > argi) {
 		SBUF_manual(wrap_file);
@@ -473,21 +476,51 @@ cmd_subprojects_download(uint32_t argc, uint32_t argi, char *const argv[])
 
 			if (!fs_file_exists(wrap_file.buf)) {
 				LOG_E("wrap file for '%s' not found", argv[argi]);
+				sbuf_destroy(&wrap_file);
 				goto ret;
 			}
 
-			if (cmd_subprojects_download_iter(&ctx, wrap_file.buf) == ir_err) {
-				goto ret;
-			}
+			cmd_subprojects_download_iter(&ctx, wrap_file.buf);
 		}
 
 		sbuf_destroy(&wrap_file);
-		res = true;
-	} else {
-		res = fs_dir_foreach(path.buf, &ctx, cmd_subprojects_download_iter);
+	} else if (!fs_dir_foreach(path.buf, &ctx, cmd_subprojects_download_iter)) {
+		goto ret;
 	}
 
+	/*
+	 * Fetch all archives up front, concurrently.  Wraps whose archives
+	 * failed to download have already been reported and are not fetched a
+	 * second time by wrap_handle.
+	 */
+	bool *failed = z_calloc(ctx.wrap_files.len ? ctx.wrap_files.len : 1, sizeof(bool));
+	wrap_prefetch(ctx.subprojects, (const char *const *)ctx.wrap_files.e, ctx.wrap_files.len, failed);
+
+	for (i = 0; i < ctx.wrap_files.len; ++i) {
+		const char *wrap_file = *(const char **)darr_get(&ctx.wrap_files, i);
+
+		if (failed[i]) {
+			LOG_E("failed to fetch %s", wrap_file);
+			continue;
+		}
+
+		LOG_I("fetching %s", wrap_file);
+		struct wrap wrap = { 0 };
+		if (!wrap_handle(wrap_file, ctx.subprojects, &wrap, true)) {
+			continue;
+		}
+
+		wrap_destroy(&wrap);
+	}
+
+	z_free(failed);
+
+	res = true;
 ret:
+	for (i = 0; i < ctx.wrap_files.len; ++i) {
+		z_free(*(char **)darr_get(&ctx.wrap_files, i));
+	}
+	darr_destroy(&ctx.wrap_files);
 	sbuf_destroy(&path);
 	return res;
 }
@@ -551,7 +584,7 @@ eval_internal(const char *filename, bool embedded, const char *argv0, char *cons
 	{ // populate argv array
 		obj argv_obj;
 		make_obj(&wk, &argv_obj, obj_array);
-		hash_set_str(&wk.scope, "argv", argv_obj);
+		scope_set(&wk, &wk.scope, "argv", argv_obj);
 
 		uint32_t i;
 		for (i = 0; i < argc; ++i) {
@@ -776,13 +809,26 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 	workspace_init(&wk);
 
 	uint32_t original_argi = argi + 1;
+	bool regenerate = false;
 
-	OPTSTART("D:c:b") {
+	OPTSTART("D:c:bj:r") {
 		case 'D':
 			if (!parse_and_set_cmdline_option(&wk, optarg)) {
 				goto ret;
 			}
 			break;
+		case 'j': {
+			char *endptr;
+			unsigned long n = strtoul(optarg, &endptr, 10);
+
+			if (n > UINT32_MAX || !*optarg || *endptr) {
+				LOG_E("invalid number of jobs: %s", optarg);
+				goto ret;
+			}
+
+			wk.compiler_check_jobs = n;
+			break;
+		}
 		case 'c': {
 			FILE *f;
 			if (!(f = fs_fopen(optarg, "rb"))) {
@@ -798,11 +844,16 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 		case 'b':
 			wk.dbg.break_on_err = true;
 			break;
+		case 'r':
+			regenerate = true;
+			break;
 	} OPTEND(argv[argi],
 		" <build dir>",
 		"  -D <option>=<value> - set project options\n"
 		"  -c <compiler_check_cache.dat> - path to compiler check cache dump\n"
-		"  -b - break on errors\n",
+		"  -b - break on errors\n"
+		"  -j <jobs> - set the number of concurrent compiler checks\n"
+		"  -r - skip setup if no build file dependencies changed\n",
 		NULL, 1)
 
 	const char *build = argv[argi];
@@ -814,6 +865,17 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 		goto ret;
 	}
 
+	if (regenerate && backend_up_to_date(&wk)) {
+		LOG_I("build files are up to date");
+		res = true;
+		goto ret;
+	}
+
+	/* A build dir that is regenerated is likely to be regenerated again,
+	 * so this is where saving asts pays off.  A one-off setup doesn't pay
+	 * for writing them. */
+	wk.ast_cache.save = regenerate;
+
 	uint32_t project_id;
 	if (!eval_project(&wk, NULL, wk.source_root, wk.build_root, &project_id)) {
 		goto ret;
@@ -827,10 +889,21 @@ cmd_setup(uint32_t argc, uint32_t argi, char *const argv[])
 
 	workspace_print_summaries(&wk, log_file());
 
+	{
+		const struct fs_find_cmd_stats *stats = fs_find_cmd_cache_stats();
+		L("PATH lookups: %" PRIu64 " cached, %" PRIu64 " uncached, %" PRIu64 " stats saved",
+			stats->hits, stats->misses, stats->lookups_saved);
+		L("directory cache: %" PRIu32 " lookups answered, %" PRIu32 " directories read",
+			wk.dir_cache.stats.hits, wk.dir_cache.stats.dirs_read);
+		L("ast cache: %" PRIu32 " hits, %" PRIu32 " loaded, %" PRIu32 " saved",
+			wk.ast_cache.stats.hits, wk.ast_cache.stats.loaded, wk.ast_cache.stats.saved);
+	}
+
 	LOG_I("setup complete");
 
 	res = true;
 ret:
+	compiler_check_cache_write_shared(&wk);
 	workspace_destroy(&wk);
 	TracyCZoneAutoE;
 	return res;
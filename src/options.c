@@ -673,31 +673,100 @@ set_str_opt_from_env(struct workspace *wk, const char *env_name, const char *opt
 	}
 }
 
+/*
+ * The builtin option scripts define the same options every time.  Once a
+ * script has been evaluated twice in one process, for example for a
+ * subproject or a second workspace, the options it created are cloned
+ * into a snapshot workspace.  From then on the script is no longer
+ * evaluated, the snapshot is copied instead.
+ */
+struct builtin_options_snapshot {
+	obj opts;
+	uint32_t evals;
+};
+
+static struct {
+	struct workspace wk;
+	bool init;
+} builtin_options_snapshot_wk;
+
+struct builtin_options_copy_ctx {
+	struct workspace *wk_src, *wk_dest;
+	obj dest;
+};
+
+static enum iteration_result
+builtin_options_copy_iter(struct workspace *wk, void *_ctx, obj key, obj opt)
+{
+	struct builtin_options_copy_ctx *ctx = _ctx;
+	obj dest_key, dest_opt;
+
+	if (!obj_clone(ctx->wk_src, ctx->wk_dest, key, &dest_key)) {
+		return ir_err;
+	} else if (!obj_clone(ctx->wk_src, ctx->wk_dest, opt, &dest_opt)) {
+		return ir_err;
+	}
+
+	obj_dict_set(ctx->wk_dest, ctx->dest, dest_key, dest_opt);
+	return ir_cont;
+}
+
+static bool
+builtin_options_copy(struct workspace *wk_src, obj src, struct workspace *wk_dest, obj dest)
+{
+	return obj_dict_foreach(wk_src, src, &(struct builtin_options_copy_ctx) {
+		.wk_src = wk_src,
+		.wk_dest = wk_dest,
+		.dest = dest,
+	}, builtin_options_copy_iter);
+}
+
 static bool
-init_builtin_options(struct workspace *wk, const char *script, const char *fallback)
+init_builtin_options(struct workspace *wk, const char *script, const char *fallback,
+	obj opts, struct builtin_options_snapshot *snapshot)
 {
-	const char *opts;
-	if (!(opts = embedded_get(script))) {
-		opts = fallback;
+	if (snapshot->opts) {
+		return builtin_options_copy(&builtin_options_snapshot_wk.wk, snapshot->opts, wk, opts);
+	}
+
+	const char *src;
+	if (!(src = embedded_get(script))) {
+		src = fallback;
 	}
 
 	enum language_mode old_mode = wk->lang_mode;
 	wk->lang_mode = language_opts;
 	obj _;
 	initializing_builtin_options = true;
-	bool ret = eval_str(wk, opts, eval_mode_default, &_);
+	bool ret = eval_str(wk, src, eval_mode_default, &_);
 	initializing_builtin_options = false;
 	wk->lang_mode = old_mode;
-	return ret;
+
+	if (!ret) {
+		return false;
+	} else if (++snapshot->evals < 2) {
+		return true;
+	}
+
+	if (!builtin_options_snapshot_wk.init) {
+		workspace_init_bare(&builtin_options_snapshot_wk.wk);
+		builtin_options_snapshot_wk.init = true;
+	}
+
+	make_obj(&builtin_options_snapshot_wk.wk, &snapshot->opts, obj_dict);
+	return builtin_options_copy(wk, opts, &builtin_options_snapshot_wk.wk, snapshot->opts);
 }
 
 static bool
 init_per_project_options(struct workspace *wk)
 {
+	static struct builtin_options_snapshot snapshot;
+
 	return init_builtin_options(wk, "per_project_options.meson",
 		"option('default_library', type: 'string', value: 'static')\n"
 		"option('warning_level', type: 'string', value: '3')\n"
-		"option('c_std', type: 'string', value: 'c99')\n"
+		"option('c_std', type: 'string', value: 'c99')\n",
+		current_project(wk)->opts, &snapshot
 		);
 }
 
@@ -797,6 +866,8 @@ setup_project_options(struct workspace *wk, const char *cwd)
 bool
 init_global_options(struct workspace *wk)
 {
+	static struct builtin_options_snapshot snapshot;
+
 	if (!init_builtin_options(wk, "global_options.meson",
 		"option('buildtype', type: 'string', value: 'debugoptimized')\n"
 		"option('prefix', type: 'string', value: '/usr/local')\n"
@@ -813,7 +884,8 @@ init_global_options(struct workspace *wk)
 		"option('werror', type: 'boolean', value: false)\n"
 
 		"option('env.CC', type: 'array', value: ['cc'])\n"
-		"option('env.NINJA', type: 'array', value: ['ninja'])\n"
+		"option('env.NINJA', type: 'array', value: ['ninja'])\n",
+		wk->global_opts, &snapshot
 		)) {
 		return false;
 	}
@@ -1048,12 +1120,12 @@ make_option_choices_iter(struct workspace *wk, void *_ctx, obj val)
 		clr = ctx->sel_clr;
 	}
 
-	str_app(wk, ctx->res, clr);
-	str_appn(wk, ctx->res, ss->s, ss->len);
-	str_app(wk, ctx->res, ctx->no_clr);
+	str_app(wk, &ctx->res, clr);
+	str_appn(wk, &ctx->res, ss->s, ss->len);
+	str_app(wk, &ctx->res, ctx->no_clr);
 
 	if (ctx->i < ctx->len - 1) {
-		str_app(wk, ctx->res, "|");
+		str_app(wk, &ctx->res, "|");
 	}
 
 	++ctx->i;
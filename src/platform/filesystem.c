@@ -27,6 +27,7 @@
 #endif
 
 #include "buf_size.h"
+#include "data/hash.h"
 #include "lang/string.h"
 #include "log.h"
 #include "platform/filesystem.h"
@@ -44,6 +45,24 @@ fs_stat(const char *path, struct stat *sb)
 	return true;
 }
 
+struct fs_dir_foreach_ctx {
+	void *usr_ctx;
+	fs_dir_foreach_cb cb;
+};
+
+static enum iteration_result
+fs_dir_foreach_iter(void *_ctx, const char *path, enum fs_dir_entry_type t)
+{
+	struct fs_dir_foreach_ctx *ctx = _ctx;
+	return ctx->cb(ctx->usr_ctx, path);
+}
+
+bool
+fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
+{
+	return fs_dir_foreach_typed(path, &(struct fs_dir_foreach_ctx) { .usr_ctx = _ctx, .cb = cb }, fs_dir_foreach_iter);
+}
+
 bool
 fs_mkdir_p(const char *path)
 {
@@ -248,6 +267,68 @@ err:
 	return false;
 }
 
+bool
+fs_map(FILE *f, struct fs_mapping *m)
+{
+	*m = (struct fs_mapping) { 0 };
+
+	bool seekable;
+	if (!fs_is_seekable(f, &seekable)) {
+		return false;
+	}
+
+	if (seekable) {
+		if (!fs_fsize(f, &m->len)) {
+			return false;
+		}
+
+		if (!m->len) {
+			return true;
+		}
+
+		if ((m->data = fs_mmap_private(f, m->len))) {
+			m->mapped = true;
+			return true;
+		}
+	}
+
+	uint64_t size = BUF_SIZE_4k;
+	size_t read;
+	m->len = 0;
+	m->data = z_malloc(size);
+
+	while ((read = fread(&m->data[m->len], 1, size - m->len, f))) {
+		m->len += read;
+
+		if (m->len == size) {
+			size *= 2;
+			m->data = z_realloc(m->data, size);
+		}
+	}
+
+	if (!feof(f)) {
+		LOG_E("failed to read entire file, only read %" PRId64 "bytes", m->len);
+		fs_unmap(m);
+		return false;
+	}
+
+	return true;
+}
+
+void
+fs_unmap(struct fs_mapping *m)
+{
+	if (!m->data) {
+		return;
+	} else if (m->mapped) {
+		fs_munmap(m->data, m->len);
+	} else {
+		z_free(m->data);
+	}
+
+	*m = (struct fs_mapping) { 0 };
+}
+
 void
 fs_source_dup(const struct source *src, struct source *dup)
 {
@@ -340,6 +421,121 @@ fs_write(const char *path, const uint8_t *buf, uint64_t buf_len)
 	return true;
 }
 
+bool
+fs_remove(const char *path)
+{
+	if (remove(path) != 0) {
+		LOG_E("failed remove(\"%s\"): %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+/*
+ * Results of looking up commands in PATH, including failed lookups.  The
+ * cache is dropped whenever PATH changes.
+ */
+struct fs_find_cmd_result {
+	char *cmd, *path;
+	uint32_t lookups;
+};
+
+static struct {
+	struct hash cmds;
+	struct darr results;
+	char *env_path;
+	struct fs_find_cmd_stats stats;
+	bool init;
+} fs_find_cmd_cache;
+
+static char *
+fs_strdup(const char *s)
+{
+	uint32_t len = strlen(s);
+	char *r = z_malloc(len + 1);
+	memcpy(r, s, len + 1);
+	return r;
+}
+
+static void
+fs_find_cmd_cache_reset(const char *env_path)
+{
+	uint32_t i;
+
+	if (!fs_find_cmd_cache.init) {
+		hash_init_str(&fs_find_cmd_cache.cmds, 64);
+		darr_init(&fs_find_cmd_cache.results, 64, sizeof(struct fs_find_cmd_result));
+		fs_find_cmd_cache.init = true;
+	}
+
+	for (i = 0; i < fs_find_cmd_cache.results.len; ++i) {
+		struct fs_find_cmd_result *r = darr_get(&fs_find_cmd_cache.results, i);
+		z_free(r->cmd);
+		if (r->path) {
+			z_free(r->path);
+		}
+	}
+
+	hash_clear(&fs_find_cmd_cache.cmds);
+	darr_clear(&fs_find_cmd_cache.results);
+
+	if (fs_find_cmd_cache.env_path) {
+		z_free(fs_find_cmd_cache.env_path);
+	}
+	fs_find_cmd_cache.env_path = fs_strdup(env_path);
+}
+
+bool
+fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd)
+{
+	uint32_t lookups = 0;
+	const char *env_path;
+
+	if (!path_is_basename(cmd) || !(env_path = getenv("PATH"))) {
+		return fs_find_cmd_uncached(wk, buf, cmd, &lookups);
+	}
+
+	if (!fs_find_cmd_cache.env_path || strcmp(fs_find_cmd_cache.env_path, env_path) != 0) {
+		fs_find_cmd_cache_reset(env_path);
+	}
+
+	uint64_t *v;
+	struct fs_find_cmd_result *r;
+	if ((v = hash_get_str(&fs_find_cmd_cache.cmds, cmd))) {
+		r = darr_get(&fs_find_cmd_cache.results, *v);
+
+		++fs_find_cmd_cache.stats.hits;
+		fs_find_cmd_cache.stats.lookups_saved += r->lookups;
+
+		sbuf_clear(buf);
+		if (!r->path) {
+			return false;
+		}
+
+		sbuf_pushs(wk, buf, r->path);
+		return true;
+	}
+
+	bool found = fs_find_cmd_uncached(wk, buf, cmd, &lookups);
+	++fs_find_cmd_cache.stats.misses;
+
+	struct fs_find_cmd_result res = {
+		.cmd = fs_strdup(cmd),
+		.path = found ? fs_strdup(buf->buf) : NULL,
+		.lookups = lookups,
+	};
+
+	hash_set_str(&fs_find_cmd_cache.cmds, res.cmd, darr_push(&fs_find_cmd_cache.results, &res));
+	return found;
+}
+
+const struct fs_find_cmd_stats *
+fs_find_cmd_cache_stats(void)
+{
+	return &fs_find_cmd_cache.stats;
+}
+
 bool
 fs_has_cmd(const char *cmd)
 {
@@ -3,12 +3,25 @@
  * SPDX-License-Identifier: GPL-3.0-only
  */
 
+/* for the DT_* constants, which _POSIX_C_SOURCE hides */
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+#if defined(__APPLE__) && !defined(_DARWIN_C_SOURCE)
+#define _DARWIN_C_SOURCE
+#endif
+
 #include "compat.h"
 
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
@@ -82,6 +95,25 @@ fs_exe_exists(const char *path)
 	return true;
 }
 
+bool
+fs_entry_type(const char *path, enum fs_dir_entry_type *t)
+{
+	struct stat sb;
+	if (stat(path, &sb) != 0) {
+		return false;
+	}
+
+	if (S_ISREG(sb.st_mode)) {
+		*t = fs_dir_entry_type_file;
+	} else if (S_ISDIR(sb.st_mode)) {
+		*t = fs_dir_entry_type_dir;
+	} else {
+		*t = fs_dir_entry_type_other;
+	}
+
+	return true;
+}
+
 bool
 fs_dir_exists(const char *path)
 {
@@ -141,12 +173,79 @@ ret:
 	return res;
 }
 
+static bool
+fs_write_fd(int fd, const uint8_t *buf, size_t len)
+{
+	ssize_t w;
+
+	while (len) {
+		if ((w = write(fd, buf, len)) == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			LOG_E("failed write(): %s", strerror(errno));
+			return false;
+		}
+
+		buf += w;
+		len -= w;
+	}
+
+	return true;
+}
+
+enum fs_copy_file_range_result {
+	fs_copy_file_range_done,
+	fs_copy_file_range_failed,
+	fs_copy_file_range_unsupported,
+};
+
+/*
+ * Let the kernel copy the data without a round trip through userspace, and
+ * share extents where the filesystem supports it.  Older kernels and some
+ * filesystem combinations reject the call, in which case the caller falls
+ * back to read()/write().  Both fds are advanced, so a fallback after a
+ * partial copy picks up where this left off.
+ */
+static enum fs_copy_file_range_result
+fs_copy_file_range(int f_src, int f_dest)
+{
+#if defined(__linux__) && defined(SYS_copy_file_range)
+	long r;
+	bool copied = false;
+	while ((r = syscall(SYS_copy_file_range, f_src, NULL, f_dest, NULL, (size_t)1 << 30, 0)) != 0) {
+		if (r > 0) {
+			copied = true;
+		} else if (r == -1) {
+			switch (errno) {
+			case EINTR: continue;
+			case ENOSYS:
+			case EXDEV:
+			case EINVAL:
+			case EOPNOTSUPP:
+			case EPERM: return fs_copy_file_range_unsupported;
+			}
+
+			LOG_E("failed copy_file_range(): %s", strerror(errno));
+			return fs_copy_file_range_failed;
+		}
+	}
+
+	/* some pseudo filesystems report eof straight away, let read() decide */
+	return copied ? fs_copy_file_range_done : fs_copy_file_range_unsupported;
+#else
+	(void)f_src;
+	(void)f_dest;
+	return fs_copy_file_range_unsupported;
+#endif
+}
+
 bool
 fs_copy_file(const char *src, const char *dest)
 {
 	bool res = false;
-	FILE *f_src = NULL;
-	int f_dest = 0;
+	int f_src = -1, f_dest = -1;
 
 	struct stat st;
 	if (!fs_lstat(src, &st)) {
@@ -160,7 +259,8 @@ fs_copy_file(const char *src, const char *dest)
 		goto ret;
 	}
 
-	if (!(f_src = fs_fopen(src, "r"))) {
+	if ((f_src = open(src, O_RDONLY)) == -1) {
+		LOG_E("failed to open %s: %s", src, strerror(errno));
 		goto ret;
 	}
 
@@ -169,42 +269,38 @@ fs_copy_file(const char *src, const char *dest)
 		goto ret;
 	}
 
-	assert(f_dest != 0);
+	switch (fs_copy_file_range(f_src, f_dest)) {
+	case fs_copy_file_range_done: res = true; goto ret;
+	case fs_copy_file_range_failed: goto ret;
+	case fs_copy_file_range_unsupported: break;
+	}
 
-	size_t r;
-	ssize_t w;
-	char buf[BUF_SIZE_32k];
+	ssize_t r;
+	uint8_t buf[BUF_SIZE_32k];
 
-	while ((r = fread(buf, 1, BUF_SIZE_32k, f_src)) > 0) {
-		errno = 0; // to ensure that we get the error from write() only
+	while ((r = read(f_src, buf, BUF_SIZE_32k)) != 0) {
+		if (r == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
 
-		if ((w = write(f_dest, buf, r)) == -1) {
-			LOG_E("failed write(): %s", strerror(errno));
+			LOG_E("failed read(): %s", strerror(errno));
+			goto ret;
+		} else if (!fs_write_fd(f_dest, buf, r)) {
 			goto ret;
-		} else {
-			assert(w >= 0);
-
-			if ((size_t)w < r) {
-				LOG_E("incomplete write: %s", strerror(errno));
-				goto ret;
-			}
 		}
 	}
 
-	if (!feof(f_src)) {
-		LOG_E("incomplete read: %s", strerror(errno));
-		goto ret;
-	}
-
 	res = true;
 ret:
-	if (f_src) {
-		if (!fs_fclose(f_src)) {
+	if (f_src != -1) {
+		if (close(f_src) == -1) {
+			LOG_E("failed close(): %s", strerror(errno));
 			res = false;
 		}
 	}
 
-	if (f_dest > 0) {
+	if (f_dest != -1) {
 		if (close(f_dest) == -1) {
 			LOG_E("failed close(): %s", strerror(errno));
 			res = false;
@@ -214,8 +310,24 @@ ret:
 	return res;
 }
 
+static enum fs_dir_entry_type
+fs_dir_entry_type(const struct dirent *ent)
+{
+#ifdef DT_DIR
+	switch (ent->d_type) {
+	case DT_REG: return fs_dir_entry_type_file;
+	case DT_DIR: return fs_dir_entry_type_dir;
+	case DT_LNK:
+	case DT_UNKNOWN: return fs_dir_entry_type_unknown;
+	default: return fs_dir_entry_type_other;
+	}
+#else
+	return fs_dir_entry_type_unknown;
+#endif
+}
+
 bool
-fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
+fs_dir_foreach_typed(const char *path, void *_ctx, fs_dir_foreach_typed_cb cb)
 {
 	DIR *d;
 	struct dirent *ent;
@@ -231,7 +343,7 @@ fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
 			continue;
 		}
 
-		switch (cb(_ctx, ent->d_name)) {
+		switch (cb(_ctx, ent->d_name, fs_dir_entry_type(ent))) {
 		case ir_cont:
 			break;
 		case ir_done:
@@ -252,17 +364,6 @@ fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
 	return res;
 }
 
-static bool
-fs_remove(const char *path)
-{
-	if (remove(path) != 0) {
-		LOG_E("failed remove(\"%s\"): %s", path, strerror(errno));
-		return false;
-	}
-
-	return true;
-}
-
 bool
 fs_make_symlink(const char *target, const char *path, bool force)
 {
@@ -286,6 +387,74 @@ fs_user_home(void)
 	return getenv("HOME");
 }
 
+void *
+fs_mmap_private(FILE *f, uint64_t len)
+{
+	int fd;
+	if (!fs_fileno(f, &fd)) {
+		return NULL;
+	}
+
+	void *addr;
+	if ((addr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		L("failed mmap(): %s", strerror(errno));
+		return NULL;
+	}
+
+	return addr;
+}
+
+void
+fs_munmap(void *addr, uint64_t len)
+{
+	if (munmap(addr, len) != 0) {
+		LOG_E("failed munmap(): %s", strerror(errno));
+	}
+}
+
+bool
+fs_rename(const char *old_path, const char *new_path)
+{
+	if (rename(old_path, new_path) != 0) {
+		LOG_E("failed rename(\"%s\", \"%s\"): %s", old_path, new_path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool
+fs_lock(FILE *f)
+{
+	int fd;
+	if (!fs_fileno(f, &fd)) {
+		return false;
+	}
+
+	if (flock(fd, LOCK_EX) != 0) {
+		LOG_E("failed flock(): %s", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
+bool
+fs_unlock(FILE *f)
+{
+	int fd;
+	if (!fs_fileno(f, &fd)) {
+		return false;
+	}
+
+	if (flock(fd, LOCK_UN) != 0) {
+		LOG_E("failed flock(): %s", strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 bool
 fs_is_a_tty_from_fd(int fd)
 {
@@ -300,6 +469,17 @@ fs_is_a_tty_from_fd(int fd)
 	}
 }
 
+bool
+fs_touch(const char *path)
+{
+	if (utimensat(AT_FDCWD, path, NULL, 0) == -1) {
+		LOG_E("failed to update timestamps of %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 bool
 fs_chmod(const char *path, uint32_t mode)
 {
@@ -333,7 +513,7 @@ fs_chmod(const char *path, uint32_t mode)
 }
 
 bool
-fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd)
+fs_find_cmd_uncached(struct workspace *wk, struct sbuf *buf, const char *cmd, uint32_t *lookups)
 {
 	assert(*cmd);
 	uint32_t len;
@@ -368,6 +548,7 @@ fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd)
 
 			path_push(wk, buf, cmd);
 
+			++*lookups;
 			if (fs_exe_exists(buf->buf)) {
 				return true;
 			}
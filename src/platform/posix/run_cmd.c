@@ -7,6 +7,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -65,25 +66,42 @@ copy_pipe(int pipe, struct run_cmd_pipe_ctx *ctx)
 	}
 }
 
+/*
+ * The read end of a pipe is closed as soon as it reaches eof, so that
+ * run_cmd_wait doesn't keep waking up for it.
+ */
 static enum copy_pipe_result
-copy_pipes(struct run_cmd_ctx *ctx)
+copy_pipe_until_eof(int fds[2], bool fds_open[2], struct run_cmd_pipe_ctx *ctx)
 {
 	enum copy_pipe_result res;
 
-	if ((res = copy_pipe(ctx->pipefd_out[0], &ctx->out)) == copy_pipe_result_failed) {
-		return res;
+	if (!fds_open[0]) {
+		return copy_pipe_result_finished;
 	}
 
-	switch (copy_pipe(ctx->pipefd_err[0], &ctx->err)) {
-	case copy_pipe_result_waiting:
-		return copy_pipe_result_waiting;
-	case copy_pipe_result_finished:
-		return res;
-	case copy_pipe_result_failed:
+	if ((res = copy_pipe(fds[0], ctx)) == copy_pipe_result_finished) {
+		if (close(fds[0]) == -1) {
+			LOG_E("failed to close: %s", strerror(errno));
+		}
+		fds_open[0] = false;
+	}
+
+	return res;
+}
+
+static enum copy_pipe_result
+copy_pipes(struct run_cmd_ctx *ctx)
+{
+	enum copy_pipe_result out, err;
+
+	if ((out = copy_pipe_until_eof(ctx->pipefd_out, ctx->pipefd_out_open, &ctx->out)) == copy_pipe_result_failed) {
 		return copy_pipe_result_failed;
-	default:
-		assert(false && "unreachable");
+	} else if ((err = copy_pipe_until_eof(ctx->pipefd_err, ctx->pipefd_err_open, &ctx->err)) == copy_pipe_result_failed) {
 		return copy_pipe_result_failed;
+	} else if (out == copy_pipe_result_finished && err == copy_pipe_result_finished) {
+		return copy_pipe_result_finished;
+	} else {
+		return copy_pipe_result_waiting;
 	}
 }
 
@@ -117,6 +135,96 @@ run_cmd_ctx_close_fds(struct run_cmd_ctx *ctx)
 
 }
 
+/*
+ * SIGCHLD is turned into a readable byte on sigchld_pipe, so run_cmd_wait
+ * can poll() for child exit alongside the output pipes.  The handler is
+ * installed before the first async command is started, so an exit can't
+ * be missed between run_cmd_collect and run_cmd_wait.
+ */
+static struct {
+	int fds[2];
+	bool init, ok;
+} sigchld_pipe;
+
+static void
+sigchld_handler(int sig)
+{
+	int saved_errno = errno;
+	ssize_t r = write(sigchld_pipe.fds[1], "", 1);
+	(void)r;
+	errno = saved_errno;
+}
+
+static void
+sigchld_pipe_init(void)
+{
+	if (sigchld_pipe.init) {
+		return;
+	}
+	sigchld_pipe.init = true;
+
+	if (pipe(sigchld_pipe.fds) == -1) {
+		LOG_W("failed to create pipe: %s", strerror(errno));
+		return;
+	}
+
+	uint32_t i;
+	for (i = 0; i < 2; ++i) {
+		int flags;
+		if ((flags = fcntl(sigchld_pipe.fds[i], F_GETFL)) == -1
+		    || fcntl(sigchld_pipe.fds[i], F_SETFL, flags | O_NONBLOCK) == -1
+		    || fcntl(sigchld_pipe.fds[i], F_SETFD, FD_CLOEXEC) == -1) {
+			LOG_W("failed to set pipe flags: %s", strerror(errno));
+			return;
+		}
+	}
+
+	struct sigaction sa = { .sa_handler = sigchld_handler, .sa_flags = SA_RESTART | SA_NOCLDSTOP };
+	sigemptyset(&sa.sa_mask);
+	if (sigaction(SIGCHLD, &sa, NULL) == -1) {
+		LOG_W("failed to install SIGCHLD handler: %s", strerror(errno));
+		return;
+	}
+
+	sigchld_pipe.ok = true;
+}
+
+void
+run_cmd_wait(struct run_cmd_ctx *const *ctxs, uint32_t len, uint32_t timeout_ms)
+{
+	struct pollfd *fds = z_calloc(len * 2 + 1, sizeof(struct pollfd));
+	uint32_t i, n = 0;
+
+	if (sigchld_pipe.ok) {
+		fds[n++] = (struct pollfd) { .fd = sigchld_pipe.fds[0], .events = POLLIN };
+	} else if (timeout_ms > 10) {
+		/* without the SIGCHLD pipe, exits can only be noticed by polling */
+		timeout_ms = 10;
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (ctxs[i]->pipefd_out_open[0]) {
+			fds[n++] = (struct pollfd) { .fd = ctxs[i]->pipefd_out[0], .events = POLLIN };
+		}
+
+		if (ctxs[i]->pipefd_err_open[0]) {
+			fds[n++] = (struct pollfd) { .fd = ctxs[i]->pipefd_err[0], .events = POLLIN };
+		}
+	}
+
+	if (poll(fds, n, timeout_ms) == -1 && errno != EINTR) {
+		LOG_W("failed poll(): %s", strerror(errno));
+	}
+
+	if (sigchld_pipe.ok) {
+		char buf[64];
+		while (read(sigchld_pipe.fds[0], buf, sizeof(buf)) > 0) {
+		}
+	}
+
+	z_free(fds);
+}
+
 enum run_cmd_state
 run_cmd_collect(struct run_cmd_ctx *ctx)
 {
@@ -255,6 +363,10 @@ run_cmd_internal(struct run_cmd_ctx *ctx, const char *_cmd, char *const *argv, c
 		}
 	}
 
+	if (ctx->flags & run_cmd_ctx_flag_async) {
+		sigchld_pipe_init();
+	}
+
 	if ((ctx->pid = fork()) == -1) {
 		goto err;
 	} else if (ctx->pid == 0 /* child */) {
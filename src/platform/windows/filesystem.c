@@ -11,6 +11,7 @@
 #endif
 #include <windows.h>
 #include <io.h>
+#include <sys/utime.h>
 #include <errno.h>
 
 #include "log.h"
@@ -38,6 +39,18 @@ fs_exists(const char *path)
 	return true;
 }
 
+bool
+fs_entry_type(const char *path, enum fs_dir_entry_type *t)
+{
+	DWORD attrs = GetFileAttributes(path);
+	if (attrs == INVALID_FILE_ATTRIBUTES) {
+		return false;
+	}
+
+	*t = (attrs & FILE_ATTRIBUTE_DIRECTORY) ? fs_dir_entry_type_dir : fs_dir_entry_type_file;
+	return true;
+}
+
 bool
 fs_symlink_exists(const char *path)
 {
@@ -196,8 +209,20 @@ fs_copy_file(const char *src, const char *dest)
 	return true;
 }
 
+static enum fs_dir_entry_type
+fs_dir_entry_type(const WIN32_FIND_DATA *fd)
+{
+	if (fd->dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) {
+		return fs_dir_entry_type_unknown;
+	} else if (fd->dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+		return fs_dir_entry_type_dir;
+	} else {
+		return fs_dir_entry_type_file;
+	}
+}
+
 bool
-fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
+fs_dir_foreach_typed(const char *path, void *_ctx, fs_dir_foreach_typed_cb cb)
 {
 	HANDLE h;
 	char *filter;
@@ -239,7 +264,7 @@ fs_dir_foreach(const char *path, void *_ctx, fs_dir_foreach_cb cb)
 			}
 		}
 
-		switch (cb(_ctx, fd.cFileName)) {
+		switch (cb(_ctx, fd.cFileName, fs_dir_entry_type(&fd))) {
 		case ir_cont:
 			break;
 		case ir_done:
@@ -278,6 +303,103 @@ fs_user_home(void)
 	return getenv("USERPROFILE");
 }
 
+void *
+fs_mmap_private(FILE *f, uint64_t len)
+{
+	int fd;
+	HANDLE h, fm;
+	void *addr;
+
+	if (!fs_fileno(f, &fd)) {
+		return NULL;
+	}
+
+	h = (HANDLE)_get_osfhandle(fd);
+	if (h == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+
+	if (!(fm = CreateFileMapping(h, NULL, PAGE_WRITECOPY, 0UL, 0UL, NULL))) {
+		L("Can not map file: %s", win32_error());
+		return NULL;
+	}
+
+	addr = MapViewOfFile(fm, FILE_MAP_COPY, 0, 0, len);
+	if (!addr) {
+		L("Can not view map: %s", win32_error());
+	}
+
+	/* the view keeps the mapping alive */
+	CloseHandle(fm);
+	return addr;
+}
+
+void
+fs_munmap(void *addr, uint64_t len)
+{
+	if (!UnmapViewOfFile(addr)) {
+		LOG_E("failed to unmap view: %s", win32_error());
+	}
+}
+
+bool
+fs_rename(const char *old_path, const char *new_path)
+{
+	if (!MoveFileEx(old_path, new_path, MOVEFILE_REPLACE_EXISTING)) {
+		LOG_E("failed to rename \"%s\" to \"%s\": %s", old_path, new_path, win32_error());
+		return false;
+	}
+
+	return true;
+}
+
+static HANDLE
+fs_lock_handle(FILE *f)
+{
+	int fd;
+	if (!fs_fileno(f, &fd)) {
+		return INVALID_HANDLE_VALUE;
+	}
+
+	return (HANDLE)_get_osfhandle(fd);
+}
+
+bool
+fs_lock(FILE *f)
+{
+	HANDLE h;
+	OVERLAPPED ov = { 0 };
+
+	if ((h = fs_lock_handle(f)) == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	if (!LockFileEx(h, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &ov)) {
+		LOG_E("failed to lock file: %s", win32_error());
+		return false;
+	}
+
+	return true;
+}
+
+bool
+fs_unlock(FILE *f)
+{
+	HANDLE h;
+	OVERLAPPED ov = { 0 };
+
+	if ((h = fs_lock_handle(f)) == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	if (!UnlockFileEx(h, 0, MAXDWORD, MAXDWORD, &ov)) {
+		LOG_E("failed to unlock file: %s", win32_error());
+		return false;
+	}
+
+	return true;
+}
+
 static inline bool
 is_wprefix(const WCHAR *s, const WCHAR *prefix)
 {
@@ -407,6 +529,17 @@ fs_is_a_tty_from_fd(int fd)
 	return false;
 }
 
+bool
+fs_touch(const char *path)
+{
+	if (_utime(path, NULL) == -1) {
+		LOG_E("failed to update timestamps of %s: %s", path, strerror(errno));
+		return false;
+	}
+
+	return true;
+}
+
 bool
 fs_chmod(const char *path, uint32_t mode)
 {
@@ -438,7 +571,7 @@ fs_has_extension(const char *path, const char *ext)
 }
 
 bool
-fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd)
+fs_find_cmd_uncached(struct workspace *wk, struct sbuf *buf, const char *cmd, uint32_t *lookups)
 {
 	assert(*cmd);
 	uint32_t len;
@@ -479,6 +612,7 @@ fs_find_cmd(struct workspace *wk, struct sbuf *buf, const char *cmd)
 
 			path_push(wk, buf, cmd);
 
+			++*lookups;
 			if (fs_exe_exists(buf->buf)) {
 				return true;
 			}else if (!fs_has_extension(buf->buf, ".exe")) {
@@ -202,6 +202,30 @@ run_cmd_collect(struct run_cmd_ctx *ctx)
 	return run_cmd_finished;
 }
 
+void
+run_cmd_wait(struct run_cmd_ctx *const *ctxs, uint32_t len, uint32_t timeout_ms)
+{
+	HANDLE handles[MAXIMUM_WAIT_OBJECTS];
+	uint32_t i, n = 0;
+
+	for (i = 0; i < len && n < MAXIMUM_WAIT_OBJECTS; ++i) {
+		if (ctxs[i]->process != INVALID_HANDLE_VALUE && ctxs[i]->process) {
+			handles[n++] = ctxs[i]->process;
+		}
+	}
+
+	/* output isn't waited for, so don't block for long */
+	if (timeout_ms > 10) {
+		timeout_ms = 10;
+	}
+
+	if (!n) {
+		Sleep(timeout_ms);
+	} else if (WaitForMultipleObjects(n, handles, FALSE, timeout_ms) == WAIT_FAILED) {
+		LOG_W("failed to wait for processes: %s", win32_error());
+	}
+}
+
 static bool
 open_pipes(HANDLE *pipe, const char *name)
 {
@@ -37,14 +37,6 @@ static const uint32_t k[] = {
 	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
 };
 
-struct buffer_state {
-	const uint8_t *p;
-	size_t len;
-	size_t total_len;
-	int single_one_delivered; /* bool */
-	int total_len_delivered;  /* bool */
-};
-
 static inline uint32_t
 right_rot(uint32_t value, unsigned int count)
 {
@@ -54,83 +46,11 @@ right_rot(uint32_t value, unsigned int count)
 	return value >> count | value << (32 - count);
 }
 
-static void
-init_buf_state(struct buffer_state *state, const void *input, size_t len)
-{
-	state->p = input;
-	state->len = len;
-	state->total_len = len;
-	state->single_one_delivered = 0;
-	state->total_len_delivered = 0;
-}
-
-static inline const uint8_t *
-calc_chunk(uint8_t chunk[CHUNK_SIZE], struct buffer_state *state)
-{
-	if (state->total_len_delivered) {
-		return NULL;
-	}
-
-	/* For whole chunks, there is no need to copy data, we just return the original chunk. */
-	if (state->len >= CHUNK_SIZE) {
-		const uint8_t *const chunk_start = state->p;
-		state->p += CHUNK_SIZE;
-		state->len -= CHUNK_SIZE;
-		return chunk_start;
-	}
-
-	const uint8_t *const chunk_start = chunk;
-	memcpy(chunk, state->p, state->len);
-	chunk += state->len;
-	size_t space_in_chunk = CHUNK_SIZE - state->len;
-	state->p += state->len;
-	state->len = 0;
-
-	/* If we are here, space_in_chunk is one at minimum. */
-	if (!state->single_one_delivered) {
-		*chunk++ = 0x80;
-		space_in_chunk -= 1;
-		state->single_one_delivered = 1;
-	}
-
-	/*
-	 * Now:
-	 * - either there is enough space left for the total length, and we can conclude,
-	 * - or there is too little space left, and we have to pad the rest of this chunk with zeroes. In the latter
-	 *   case, we will conclude at the next invocation of this function.
-	 */
-	if (space_in_chunk >= TOTAL_LEN_LEN) {
-		const size_t left = space_in_chunk - TOTAL_LEN_LEN;
-		size_t len = state->total_len;
-		int i;
-		memset(chunk, 0x00, left);
-		chunk += left;
-
-		/* Storing of len * 8 as a big endian 64-bit without overflow. */
-		chunk[7] = (uint8_t)(len << 3);
-		len >>= 5;
-		for (i = 6; i >= 0; i--) {
-			chunk[i] = (uint8_t)len;
-			len >>= 8;
-		}
-		state->total_len_delivered = 1;
-	} else {
-		memset(chunk, 0x00, space_in_chunk);
-	}
-
-	return chunk_start;
-}
-
 /*
- * Limitations:
- * - Since input is a pointer, the data to hash must be directly accessible to the processor, which could be a problem
- *   for large data sizes.
- * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support for bit string
- *   lengths that are not multiples of eight, and it really operates on arrays of bytes.  In particular, the len
- *   parameter is a number of bytes.
+ * Process n 512-bit chunks, updating the hash values h.
  */
-void
-calc_sha_256(uint8_t hash[32], const void *input, size_t len)
+static void
+sha_256_blocks_scalar(uint32_t h[8], const uint8_t *p, size_t n)
 {
 	/*
 	 * Note 1: All integers (expect indexes) are 32-bit unsigned integers and addition is calculated modulo 2^32.
@@ -144,24 +64,9 @@ calc_sha_256(uint8_t hash[32], const void *input, size_t len)
 	 * message block data from bytes to words, for example, the first word of the input message "abc" after padding
 	 * is 0x61626380.
 	 */
-
-	/*
-	 * Initialize hash values (first 32 bits of the fractional parts of the square roots of the first 8 primes
-	 * 2..19):
-	 */
-	uint32_t h[] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
 	unsigned i, j;
 
-	/* 512-bit chunks is what we will operate on. */
-	uint8_t chunk[CHUNK_SIZE];
-
-	struct buffer_state state;
-
-	init_buf_state(&state, input, len);
-
-	const uint8_t *p;
-
-	while ((p = calc_chunk(chunk, &state))) {
+	for (; n; --n) {
 		uint32_t ah[8];
 
 		/* Initialize working variables to current hash value: */
@@ -224,12 +129,283 @@ calc_sha_256(uint8_t hash[32], const void *input, size_t len)
 			h[i] += ah[i];
 		}
 	}
+}
+
+/*
+ * Hardware implementations.  The x86 SHA extensions are detected at
+ * runtime, so they are compiled whenever the compiler supports per-function
+ * target attributes.  The ARMv8 crypto extensions are only used when the
+ * compiler already targets them, e.g. on Apple silicon or with -march.
+ */
+#if defined(__GNUC__) && !defined(__TINYC__) && (defined(__x86_64__) || defined(__i386__))
+#define SHA_256_HAVE_SHANI
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+__attribute__((target("sha,ssse3,sse4.1")))
+static void
+sha_256_blocks_shani(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i state0, state1, tmp, msg, w[4];
+	unsigned i;
+
+	/* The sha256rnds2 instruction wants the state as ABEF and CDGH. */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&h[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	for (; n; --n, p += CHUNK_SIZE) {
+		const __m128i abef = state0, cdgh = state1;
+
+		/* w[i & 3] holds message schedule words 4i..4i+3. */
+		for (i = 0; i < 16; ++i) {
+			if (i < 4) {
+				w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)&p[i * 16]), bswap);
+			} else {
+				tmp = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4));
+				w[i & 3] = _mm_sha256msg2_epu32(tmp, w[(i + 3) & 3]);
+			}
+
+			msg = _mm_add_epi32(w[i & 3], _mm_loadu_si128((const __m128i *)&k[i * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+	_mm_storeu_si128((__m128i *)&h[0], state0);
+	_mm_storeu_si128((__m128i *)&h[4], state1);
+}
+
+static int
+sha_256_have_shani(void)
+{
+	unsigned a, b, c, d;
+
+	if (!__get_cpuid(1, &a, &b, &c, &d)) {
+		return 0;
+	} else if (!(c & (1u << 9)) || !(c & (1u << 19))) {
+		/* ssse3, sse4.1 */
+		return 0;
+	} else if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) {
+		return 0;
+	}
+
+	return (b >> 29) & 1;
+}
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))
+#define SHA_256_HAVE_ARMV8
+
+#include <arm_neon.h>
+
+static void
+sha_256_blocks_armv8(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	uint32x4_t state0 = vld1q_u32(&h[0]), state1 = vld1q_u32(&h[4]), wk, tmp, w[4];
+	unsigned i;
+
+	for (; n; --n, p += CHUNK_SIZE) {
+		const uint32x4_t abcd = state0, efgh = state1;
+
+		/* w[i & 3] holds message schedule words 4i..4i+3. */
+		for (i = 0; i < 16; ++i) {
+			if (i < 4) {
+				w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&p[i * 16])));
+			} else {
+				w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]),
+					w[(i + 2) & 3], w[(i + 3) & 3]);
+			}
+
+			wk = vaddq_u32(w[i & 3], vld1q_u32(&k[i * 4]));
+			tmp = state0;
+			state0 = vsha256hq_u32(state0, state1, wk);
+			state1 = vsha256h2q_u32(state1, tmp, wk);
+		}
+
+		state0 = vaddq_u32(state0, abcd);
+		state1 = vaddq_u32(state1, efgh);
+	}
+
+	vst1q_u32(&h[0], state0);
+	vst1q_u32(&h[4], state1);
+}
+#endif
+
+static void sha_256_blocks_detect(uint32_t h[8], const uint8_t *p, size_t n);
+
+static struct {
+	void (*blocks)(uint32_t h[8], const uint8_t *p, size_t n);
+	const char *name;
+} sha_256_impl = { sha_256_blocks_detect, 0 };
+
+static void
+sha_256_select(void)
+{
+	sha_256_impl.blocks = sha_256_blocks_scalar;
+	sha_256_impl.name = "scalar";
+
+#ifdef SHA_256_HAVE_SHANI
+	if (sha_256_have_shani()) {
+		sha_256_impl.blocks = sha_256_blocks_shani;
+		sha_256_impl.name = "sha-ni";
+	}
+#endif
+
+#ifdef SHA_256_HAVE_ARMV8
+	sha_256_impl.blocks = sha_256_blocks_armv8;
+	sha_256_impl.name = "armv8";
+#endif
+}
+
+static void
+sha_256_blocks_detect(uint32_t h[8], const uint8_t *p, size_t n)
+{
+	sha_256_select();
+	sha_256_impl.blocks(h, p, n);
+}
+
+const char *
+sha_256_impl_name(void)
+{
+	if (!sha_256_impl.name) {
+		sha_256_select();
+	}
+
+	return sha_256_impl.name;
+}
+
+void
+sha_256_force_scalar(void)
+{
+	sha_256_impl.blocks = sha_256_blocks_scalar;
+	sha_256_impl.name = "scalar";
+}
+
+void
+sha_256_init(struct sha_256 *sha)
+{
+	/*
+	 * Initialize hash values (first 32 bits of the fractional parts of the square roots of the first 8 primes
+	 * 2..19):
+	 */
+	static const uint32_t h0[] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(sha->h, h0, sizeof(h0));
+	sha->chunk_len = 0;
+	sha->total_len = 0;
+}
+
+void
+sha_256_write(struct sha_256 *sha, const void *input, size_t len)
+{
+	const uint8_t *p = input;
+
+	sha->total_len += len;
+
+	/* Top up a partial chunk left over from the previous write. */
+	if (sha->chunk_len) {
+		size_t n = CHUNK_SIZE - sha->chunk_len;
+		if (n > len) {
+			n = len;
+		}
+
+		memcpy(&sha->chunk[sha->chunk_len], p, n);
+		sha->chunk_len += n;
+		p += n;
+		len -= n;
+
+		if (sha->chunk_len < CHUNK_SIZE) {
+			return;
+		}
+
+		sha_256_impl.blocks(sha->h, sha->chunk, 1);
+		sha->chunk_len = 0;
+	}
+
+	/* For whole chunks, there is no need to copy data, we just hash the original chunks. */
+	if (len >= CHUNK_SIZE) {
+		sha_256_impl.blocks(sha->h, p, len / CHUNK_SIZE);
+		p += len - len % CHUNK_SIZE;
+		len %= CHUNK_SIZE;
+	}
+
+	memcpy(sha->chunk, p, len);
+	sha->chunk_len = len;
+}
+
+void
+sha_256_close(struct sha_256 *sha, uint8_t hash[32])
+{
+	unsigned i, j;
+	uint8_t *chunk = &sha->chunk[sha->chunk_len];
+	size_t space_in_chunk = CHUNK_SIZE - sha->chunk_len;
+	uint64_t len = sha->total_len;
+
+	/* There is always room for the single one bit, since a full chunk is consumed immediately. */
+	*chunk++ = 0x80;
+	space_in_chunk -= 1;
+
+	/*
+	 * Either there is enough space left for the total length, or we have to pad the rest of this chunk with
+	 * zeroes and store the total length in a final chunk.
+	 */
+	if (space_in_chunk < TOTAL_LEN_LEN) {
+		memset(chunk, 0x00, space_in_chunk);
+		sha_256_impl.blocks(sha->h, sha->chunk, 1);
+		chunk = sha->chunk;
+		space_in_chunk = CHUNK_SIZE;
+	}
+
+	memset(chunk, 0x00, space_in_chunk - TOTAL_LEN_LEN);
+	chunk += space_in_chunk - TOTAL_LEN_LEN;
+
+	/* Storing of len * 8 as a big endian 64-bit without overflow. */
+	chunk[7] = (uint8_t)(len << 3);
+	len >>= 5;
+	for (i = 7; i-- > 0;) {
+		chunk[i] = (uint8_t)len;
+		len >>= 8;
+	}
+
+	sha_256_impl.blocks(sha->h, sha->chunk, 1);
 
 	/* Produce the final hash value (big-endian): */
 	for (i = 0, j = 0; i < 8; i++) {
-		hash[j++] = (uint8_t)(h[i] >> 24);
-		hash[j++] = (uint8_t)(h[i] >> 16);
-		hash[j++] = (uint8_t)(h[i] >> 8);
-		hash[j++] = (uint8_t)h[i];
+		hash[j++] = (uint8_t)(sha->h[i] >> 24);
+		hash[j++] = (uint8_t)(sha->h[i] >> 16);
+		hash[j++] = (uint8_t)(sha->h[i] >> 8);
+		hash[j++] = (uint8_t)sha->h[i];
 	}
 }
+
+/*
+ * Limitations:
+ * - SHA algorithms theoretically operate on bit strings. However, this implementation has no support for bit string
+ *   lengths that are not multiples of eight, and it really operates on arrays of bytes.  In particular, the len
+ *   parameter is a number of bytes.
+ */
+void
+calc_sha_256(uint8_t hash[32], const void *input, size_t len)
+{
+	struct sha_256 sha;
+
+	sha_256_init(&sha);
+	sha_256_write(&sha, input, len);
+	sha_256_close(&sha, hash);
+}
@@ -220,24 +220,28 @@ wrap_parse_provides_cb(void *_ctx, struct source *src, const char *sect,
 }
 
 static bool
-checksum(const uint8_t *file_buf, uint64_t len, const char *sha256)
+checksum_valid(const char *sha256)
 {
-	char buf[3] = { 0 };
-	uint32_t i;
-	uint8_t b, hash[32];
-
 	if (strlen(sha256) != 64) {
 		LOG_E("checksum '%s' is not 64 characters long", sha256);
 		return false;
 	}
 
-	calc_sha_256(hash, file_buf, len);
+	return true;
+}
+
+static bool
+checksum_compare(const uint8_t hash[32], const char *sha256, const char *label)
+{
+	char buf[3] = { 0 };
+	uint32_t i;
+	uint8_t b;
 
 	for (i = 0; i < 64; i += 2) {
 		memcpy(buf, &sha256[i], 2);
 		b = strtol(buf, NULL, 16);
 		if (b != hash[i / 2]) {
-			LOG_E("checksum mismatch");
+			LOG_E("checksum mismatch for '%s'", label);
 			return false;
 		}
 	}
@@ -245,11 +249,68 @@ checksum(const uint8_t *file_buf, uint64_t len, const char *sha256)
 	return true;
 }
 
+static bool
+checksum(const uint8_t *file_buf, uint64_t len, const char *sha256, const char *label)
+{
+	uint8_t hash[32];
+
+	if (!checksum_valid(sha256)) {
+		return false;
+	}
+
+	calc_sha_256(hash, file_buf, len);
+	return checksum_compare(hash, sha256, label);
+}
+
+/*
+ * Hash a file without reading all of it into memory.
+ */
+static bool
+checksum_file(const char *path, const char *sha256)
+{
+	bool res = false;
+	FILE *f;
+	uint64_t len, n;
+	uint8_t hash[32];
+	struct sha_256 sha;
+
+	if (!checksum_valid(sha256)) {
+		return false;
+	}
+
+	if (!(f = fs_fopen(path, "rb"))) {
+		return false;
+	}
+
+	uint8_t *buf = z_malloc(MUON_CURL_FETCH_BUF_SIZE);
+
+	if (!fs_fsize(f, &len)) {
+		goto ret;
+	}
+
+	sha_256_init(&sha);
+	for (; len; len -= n) {
+		n = len > MUON_CURL_FETCH_BUF_SIZE ? MUON_CURL_FETCH_BUF_SIZE : len;
+		if (!fs_fread(buf, n, f)) {
+			goto ret;
+		}
+
+		sha_256_write(&sha, buf, n);
+	}
+	sha_256_close(&sha, hash);
+
+	res = checksum_compare(hash, sha256, path);
+ret:
+	z_free(buf);
+	fs_fclose(f);
+	return res;
+}
+
 static bool
 checksum_extract(const char *buf, size_t len, const char *sha256,
-	const char *dest_dir)
+	const char *dest_dir, const char *label)
 {
-	if (sha256 && !checksum((const uint8_t *)buf, len, sha256)) {
+	if (sha256 && !checksum((const uint8_t *)buf, len, sha256, label)) {
 		return false;
 	} else if (!muon_archive_extract(buf, len, dest_dir)) {
 		return false;
@@ -258,28 +319,183 @@ checksum_extract(const char *buf, size_t len, const char *sha256,
 	return true;
 }
 
+/*
+ * Downloads go to subprojects/packagecache, like meson.  They are written
+ * to a temporary file and hashed as they arrive, and only renamed into
+ * place once the transfer completed and the checksum matched.  Nothing but
+ * curl's transfer buffer and the stdio buffer is held in memory per
+ * download.
+ */
+#define WRAP_FETCH_MAX_PARALLEL 8
+
+struct wrap_fetch {
+	const char *url, *sha256;
+	char path_buf[BUF_SIZE_1k], tmp_path_buf[BUF_SIZE_1k];
+	struct sbuf path, tmp_path;
+	FILE *f;
+	struct sha_256 sha;
+	uint32_t wrap_idx;
+	bool write_failed, ok;
+};
+
+static void
+wrap_packagecache_path(const char *subprojects, const char *filename, struct sbuf *buf)
+{
+	path_join(NULL, buf, subprojects, "packagecache");
+	path_push(NULL, buf, filename);
+}
+
+static void
+wrap_fetch_init(struct wrap_fetch *fetch, const char *url, const char *sha256,
+	const char *subprojects, const char *filename)
+{
+	*fetch = (struct wrap_fetch) { .url = url, .sha256 = sha256 };
+	sbuf_init(&fetch->path, fetch->path_buf,
+		ARRAY_LEN(fetch->path_buf), sbuf_flag_overflow_alloc);
+	sbuf_init(&fetch->tmp_path, fetch->tmp_path_buf,
+		ARRAY_LEN(fetch->tmp_path_buf), sbuf_flag_overflow_alloc);
+
+	wrap_packagecache_path(subprojects, filename, &fetch->path);
+	sbuf_pushf(NULL, &fetch->tmp_path, "%s.part", fetch->path.buf);
+}
+
+static void
+wrap_fetch_destroy(struct wrap_fetch *fetch)
+{
+	sbuf_destroy(&fetch->path);
+	sbuf_destroy(&fetch->tmp_path);
+}
+
+static bool
+wrap_fetch_write(void *_ctx, const uint8_t *buf, uint64_t len)
+{
+	struct wrap_fetch *fetch = _ctx;
+
+	if (!fs_fwrite(buf, len, fetch->f)) {
+		fetch->write_failed = true;
+		return false;
+	}
+
+	sha_256_write(&fetch->sha, buf, len);
+	return true;
+}
+
 static bool
-fetch_checksum_extract(const char *src, const char *dest, const char *sha256,
-	const char *dest_dir)
+wrap_fetch_many(struct wrap_fetch *fetches, uint32_t len)
 {
-	bool res = false;
-	uint8_t *dlbuf = NULL;
-	uint64_t dlbuf_len;
+	bool res = true;
+	uint32_t i;
+	uint8_t hash[32];
+	SBUF_manual(dir);
+
+	struct muon_curl_fetch_req *reqs = z_calloc(len, sizeof(struct muon_curl_fetch_req));
+
+	for (i = 0; i < len; ++i) {
+		struct wrap_fetch *fetch = &fetches[i];
+
+		if (fetch->sha256 && !checksum_valid(fetch->sha256)) {
+			res = false;
+			continue;
+		}
+
+		path_dirname(NULL, &dir, fetch->path.buf);
+		if (!fs_mkdir_p(dir.buf)) {
+			res = false;
+			continue;
+		}
+
+		if (!(fetch->f = fs_fopen(fetch->tmp_path.buf, "wb"))) {
+			res = false;
+			continue;
+		}
+
+		sha_256_init(&fetch->sha);
+
+		reqs[i] = (struct muon_curl_fetch_req) {
+			.url = fetch->url,
+			.write = wrap_fetch_write,
+			.ctx = fetch,
+		};
+	}
+
+	/* compact the requests that could be started */
+	uint32_t reqs_len = 0;
+	for (i = 0; i < len; ++i) {
+		if (reqs[i].url) {
+			reqs[reqs_len++] = reqs[i];
+		}
+	}
 
 	muon_curl_init();
+	if (!muon_curl_fetch_many(reqs, reqs_len, WRAP_FETCH_MAX_PARALLEL)) {
+		res = false;
+	}
+	muon_curl_deinit();
+
+	for (i = 0; i < reqs_len; ++i) {
+		struct wrap_fetch *fetch = reqs[i].ctx;
+		bool ok = reqs[i].ok;
+
+		if (!fs_fclose(fetch->f)) {
+			ok = false;
+		}
+		fetch->f = NULL;
+
+		if (ok && fetch->sha256) {
+			sha_256_close(&fetch->sha, hash);
+			ok = checksum_compare(hash, fetch->sha256, fetch->url);
+		}
+
+		if (ok) {
+			ok = fs_rename(fetch->tmp_path.buf, fetch->path.buf);
+		} else {
+			fs_remove(fetch->tmp_path.buf);
+		}
+
+		if (!ok) {
+			res = false;
+		}
+
+		fetch->ok = ok;
+	}
+
+	z_free(reqs);
+	sbuf_destroy(&dir);
+	return res;
+}
+
+static bool
+fetch_checksum_extract(const char *url, const char *filename, const char *sha256,
+	const char *subprojects, const char *dest_dir)
+{
+	bool res = false;
+	struct wrap_fetch fetch;
+
+	wrap_fetch_init(&fetch, url, sha256, subprojects, filename);
+
+	if (fs_file_exists(fetch.path.buf)) {
+		if (!sha256 || checksum_file(fetch.path.buf, sha256)) {
+			goto extract;
+		}
+
+		LOG_W("removing '%s' from the package cache", fetch.path.buf);
+		if (!fs_remove(fetch.path.buf)) {
+			goto ret;
+		}
+	}
 
-	if (!muon_curl_fetch(src, &dlbuf, &dlbuf_len)) {
+	if (!wrap_fetch_many(&fetch, 1)) {
 		goto ret;
-	} else if (!checksum_extract((const char *)dlbuf, dlbuf_len, sha256, dest_dir)) {
+	}
+
+extract:
+	if (!muon_archive_extract_file(fetch.path.buf, dest_dir)) {
 		goto ret;
 	}
 
 	res = true;
 ret:
-	if (dlbuf) {
-		z_free(dlbuf);
-	}
-	muon_curl_deinit();
+	wrap_fetch_destroy(&fetch);
 	return res;
 }
 
@@ -308,7 +524,7 @@ wrap_download_or_check_packagefiles(const char *filename, const char *url,
 			goto ret;
 		}
 
-		if (!checksum_extract(src.src, src.len, hash, dest_dir)) {
+		if (!checksum_extract(src.src, src.len, hash, dest_dir, source_path.buf)) {
 			fs_source_destroy(&src);
 			goto ret;
 		}
@@ -331,7 +547,7 @@ wrap_download_or_check_packagefiles(const char *filename, const char *url,
 			LOG_E("wrap downloading is disabled");
 			goto ret;
 		}
-		res = fetch_checksum_extract(url, filename, hash, dest_dir);
+		res = fetch_checksum_extract(url, filename, hash, subprojects, dest_dir);
 	} else {
 		LOG_E("no url specified, but '%s' is not a file or directory", source_path.buf);
 	}
@@ -688,6 +904,98 @@ ret:
 	return res;
 }
 
+static void
+wrap_prefetch_push(struct wrap_fetch *fetches, uint32_t *len, uint32_t wrap_idx,
+	const char *subprojects, const char *url, const char *filename, const char *sha256)
+{
+	bool skip;
+	SBUF_manual(path);
+
+	if (!url || !filename) {
+		return;
+	}
+
+	path_join(NULL, &path, subprojects, "packagefiles");
+	path_push(NULL, &path, filename);
+	skip = fs_exists(path.buf);
+
+	if (!skip) {
+		wrap_packagecache_path(subprojects, filename, &path);
+		skip = fs_file_exists(path.buf);
+	}
+
+	sbuf_destroy(&path);
+
+	if (!skip) {
+		wrap_fetch_init(&fetches[*len], url, sha256, subprojects, filename);
+		fetches[*len].wrap_idx = wrap_idx;
+		++*len;
+	}
+}
+
+bool
+wrap_prefetch(const char *subprojects, const char *const wrap_files[], uint32_t len, bool failed[])
+{
+	bool res;
+	uint32_t i, fetches_len = 0;
+	SBUF_manual(meson_build);
+
+	struct wrap *wraps = z_calloc(len, sizeof(struct wrap));
+	bool *parsed = z_calloc(len, sizeof(bool));
+	/* each wrap has at most a source and a patch archive */
+	struct wrap_fetch *fetches = z_calloc(len * 2, sizeof(struct wrap_fetch));
+
+	for (i = 0; i < len; ++i) {
+		struct wrap *wrap = &wraps[i];
+
+		/* errors are reported again when the wrap is handled */
+		if (!(parsed[i] = wrap_parse(wrap_files[i], wrap))) {
+			continue;
+		} else if (wrap->type != wrap_type_file) {
+			continue;
+		}
+
+		path_join(NULL, &meson_build, wrap->dest_dir.buf, "meson.build");
+		if (fs_file_exists(meson_build.buf)) {
+			continue;
+		}
+
+		wrap_prefetch_push(fetches, &fetches_len, i, subprojects,
+			wrap->fields[wf_source_url],
+			wrap->fields[wf_source_filename],
+			wrap->fields[wf_source_hash]);
+
+		if (!wrap->fields[wf_patch_directory]) {
+			wrap_prefetch_push(fetches, &fetches_len, i, subprojects,
+				wrap->fields[wf_patch_url],
+				wrap->fields[wf_patch_filename],
+				wrap->fields[wf_patch_hash]);
+		}
+	}
+
+	res = !fetches_len || wrap_fetch_many(fetches, fetches_len);
+
+	for (i = 0; i < fetches_len; ++i) {
+		if (!fetches[i].ok) {
+			failed[fetches[i].wrap_idx] = true;
+		}
+
+		wrap_fetch_destroy(&fetches[i]);
+	}
+
+	for (i = 0; i < len; ++i) {
+		if (parsed[i]) {
+			wrap_destroy(&wraps[i]);
+		}
+	}
+
+	z_free(fetches);
+	z_free(parsed);
+	z_free(wraps);
+	sbuf_destroy(&meson_build);
+	return res;
+}
+
 struct wrap_load_all_ctx {
 	struct workspace *wk;
 	const char *subprojects;
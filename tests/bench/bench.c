@@ -0,0 +1,54 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include "compat.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+enum bench_mode
+bench_parse_args(int argc, char *const argv[], const char *unit,
+	uint32_t base, uint64_t max, uint64_t *n)
+{
+	char *end;
+	uint32_t shift = 0;
+
+	if (argc != 2) {
+		fprintf(stderr, "usage: %s check|<%s>[k|m|g]\n", argv[0], unit);
+		return bench_mode_invalid;
+	}
+
+	if (strcmp(argv[1], "check") == 0) {
+		return bench_mode_check;
+	}
+
+	*n = strtoull(argv[1], &end, 10);
+	switch (*end) {
+	case 'g': ++shift;
+	/* fallthrough */
+	case 'm': ++shift;
+	/* fallthrough */
+	case 'k': ++shift;
+		++end;
+		break;
+	}
+
+	bool valid = *argv[1] >= '0' && *argv[1] <= '9' && !*end && *n;
+	for (; valid && shift; --shift) {
+		valid = *n <= max / base;
+		*n *= base;
+	}
+
+	if (!valid || *n > max) {
+		fprintf(stderr, "invalid argument '%s'\n", argv[1]);
+		return bench_mode_invalid;
+	}
+
+	return bench_mode_run;
+}
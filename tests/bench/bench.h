@@ -0,0 +1,28 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#ifndef MUON_TESTS_BENCH_H
+#define MUON_TESTS_BENCH_H
+
+#include <stdint.h>
+
+enum bench_mode {
+	bench_mode_invalid,
+	bench_mode_check,
+	bench_mode_run,
+};
+
+/*
+ * Parse the arguments shared by all benchmarks:
+ *
+ *   <prog> check
+ *   <prog> <n>[k|m|g]
+ *
+ * Each suffix multiplies n by base.  n must be between 1 and max.  Errors
+ * and the usage text are printed to stderr.
+ */
+enum bench_mode bench_parse_args(int argc, char *const argv[], const char *unit,
+	uint32_t base, uint64_t max, uint64_t *n);
+#endif
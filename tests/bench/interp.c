@@ -0,0 +1,176 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * Parse and interpret benchmark for a large generated build tree.
+ *
+ * usage: interp check
+ *        interp <blocks>[k|m|g]
+ *
+ * Each block assigns an array, indexes it, calls a few methods and takes
+ * one branch of an if/elif/else, about 70 nodes in all.  Blocks are split
+ * into files of 200 blocks, like the meson.build files of a large project,
+ * which are all parsed and then all interpreted.  The time spent in each is
+ * printed along with the number of nodes and the size of the node arrays,
+ * which is what the interpreter walks.  To count cache misses, run it
+ * under e.g.
+ *
+ *   perf stat -e cache-references,cache-misses interp 100k
+ *
+ * check interprets a few thousand blocks and asserts on the results.
+ */
+
+#include "compat.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+#include "lang/interpreter.h"
+#include "lang/parser.h"
+#include "lang/string.h"
+#include "lang/workspace.h"
+#include "log.h"
+#include "platform/filesystem.h"
+#include "platform/init.h"
+#include "platform/mem.h"
+#include "platform/path.h"
+
+#define BLOCKS_PER_FILE 200
+
+struct bench_file {
+	struct sbuf buf;
+	struct source src;
+	struct source_data sdata;
+	struct ast ast;
+};
+
+static void
+make_source(struct workspace *wk, struct sbuf *buf, uint32_t start, uint32_t n, int64_t *total, int64_t *names)
+{
+	uint32_t i;
+
+	for (i = start; i < start + n; ++i) {
+		sbuf_pushf(wk, buf,
+			"x_%u = [%u, %u + 1, 'f@0@.c'.format(%u)]\n"
+			"if x_%u[0] %% 3 == 0 and x_%u.length() == 3\n"
+			"  total += x_%u[1]\n"
+			"elif %u %% 3 == 1\n"
+			"  names += x_%u[2]\n"
+			"else\n"
+			"  d = {'k': %u}\n"
+			"  total += d['k'] * 2\n"
+			"endif\n",
+			i, i, i, i, i, i, i, i, i, i);
+
+		switch (i % 3) {
+		case 0: *total += i + 1; break;
+		case 1: ++*names; break;
+		case 2: *total += i * 2; break;
+		}
+	}
+}
+
+static double
+secs_since(clock_t start)
+{
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static bool
+run(uint32_t n, bool print)
+{
+	bool ret = false;
+	struct workspace wk = { 0 };
+	workspace_init(&wk);
+	interpreter_init();
+
+	uint32_t proj_id;
+	make_project(&wk, &proj_id, "bench", wk.source_root, wk.build_root);
+
+	uint32_t i, files_len = (n + BLOCKS_PER_FILE - 1) / BLOCKS_PER_FILE + 1, nodes = 0;
+	struct bench_file *files = z_calloc(files_len, sizeof(struct bench_file));
+	int64_t total = 0, names = 0;
+
+	for (i = 0; i < files_len; ++i) {
+		struct bench_file *f = &files[i];
+		sbuf_init(&f->buf, 0, 0, sbuf_flag_overflow_alloc);
+
+		if (i == 0) {
+			sbuf_pushs(&wk, &f->buf, "total = 0\nnames = []\n");
+		} else if (i == files_len - 1) {
+			sbuf_pushf(&wk, &f->buf,
+				"assert(total == %" PRId64 ")\n"
+				"assert(names.length() == %" PRId64 ")\n",
+				total, names);
+		} else {
+			uint32_t start = (i - 1) * BLOCKS_PER_FILE;
+			make_source(&wk, &f->buf, start, n - start < BLOCKS_PER_FILE ? n - start : BLOCKS_PER_FILE, &total, &names);
+		}
+
+		f->src = (struct source) { .label = "<bench>", .src = f->buf.buf, .len = f->buf.len };
+	}
+
+	clock_t start = clock();
+	for (i = 0; i < files_len; ++i) {
+		if (!parser_parse(&wk, &files[i].ast, &files[i].sdata, &files[i].src, 0)) {
+			goto ret;
+		}
+		nodes += files[i].ast.nodes.len;
+	}
+	double parse_secs = secs_since(start);
+
+	start = clock();
+	for (i = 0; i < files_len; ++i) {
+		obj res;
+		wk.src = &files[i].src;
+		wk.ast = &files[i].ast;
+		if (!wk.interp_node(&wk, wk.ast->root, &res)) {
+			fprintf(stderr, "interpreting failed\n");
+			goto ret;
+		}
+	}
+	double interp_secs = secs_since(start);
+
+	if (print) {
+		printf("%8u blocks %10u nodes %4u bytes/node %8.1fMiB  parse %7.3fs  interpret %7.3fs\n",
+			n,
+			nodes,
+			(uint32_t)sizeof(struct node),
+			(double)nodes * sizeof(struct node) / (1024 * 1024),
+			parse_secs,
+			interp_secs);
+	}
+
+	ret = true;
+ret:
+	for (i = 0; i < files_len; ++i) {
+		ast_destroy(&files[i].ast);
+		source_data_destroy(&files[i].sdata);
+		sbuf_destroy(&files[i].buf);
+	}
+	z_free(files);
+	workspace_destroy(&wk);
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t n;
+
+	platform_init();
+	log_init();
+	path_init();
+
+	switch (bench_parse_args(argc, argv, "blocks", 1000, UINT32_MAX, &n)) {
+	case bench_mode_invalid: return 1;
+	case bench_mode_check: return run(5000, false) ? 0 : 1;
+	case bench_mode_run: break;
+	}
+
+	return run(n, true) ? 0 : 1;
+}
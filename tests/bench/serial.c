@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * Round trip check and benchmark for serial_dump and serial_load.
+ *
+ * usage: serial check
+ *        serial <strings>[k|m|g]
+ *
+ * An array of the given number of strings, of varying lengths, is dumped
+ * to a temporary file and loaded back.  The time spent in each is
+ * printed.  check does the same with a few thousand strings, nested
+ * arrays and a dict, and compares the loaded object with the original.
+ */
+
+#include "compat.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#include "bench.h"
+#include "lang/object.h"
+#include "lang/serial.h"
+#include "lang/string.h"
+#include "lang/workspace.h"
+#include "log.h"
+#include "platform/init.h"
+
+static obj
+make_strings(struct workspace *wk, uint32_t n)
+{
+	uint32_t i;
+	obj arr;
+
+	make_obj(wk, &arr, obj_array);
+	for (i = 0; i < n; ++i) {
+		/* 8 to 71 bytes, about the size of compiler arguments and paths */
+		obj_array_push(wk, arr, make_strf(wk, "%0*u", (int)(8 + (i * 2654435761u >> 26)), i));
+	}
+
+	return arr;
+}
+
+static bool
+round_trip(struct workspace *wk, obj o, obj *res, double *dump_secs, double *load_secs, long *size)
+{
+	bool ret = false;
+	FILE *f;
+
+	if (!(f = tmpfile())) {
+		fprintf(stderr, "failed to create temporary file\n");
+		return false;
+	}
+
+	clock_t start = clock();
+	if (!serial_dump(wk, o, f) || fflush(f) != 0) {
+		fprintf(stderr, "serial_dump failed\n");
+		goto ret;
+	}
+	*dump_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+	*size = ftell(f);
+
+	rewind(f);
+
+	start = clock();
+	if (!serial_load(wk, res, f)) {
+		fprintf(stderr, "serial_load failed\n");
+		goto ret;
+	}
+	*load_secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	ret = true;
+ret:
+	fclose(f);
+	return ret;
+}
+
+static bool
+check(void)
+{
+	bool ret = false;
+	struct workspace wk = { 0 };
+	workspace_init_bare(&wk);
+
+	obj arr = make_strings(&wk, 5000), d, nested, res;
+
+	make_obj(&wk, &d, obj_dict);
+	obj_dict_set(&wk, d, make_str(&wk, "key"), make_str(&wk, "value"));
+	obj_dict_set(&wk, d, make_str(&wk, "strings"), make_strings(&wk, 10));
+	obj_array_push(&wk, arr, d);
+
+	make_obj(&wk, &nested, obj_array);
+	obj_array_push(&wk, nested, make_str(&wk, ""));
+	obj_array_push(&wk, nested, arr);
+	obj_array_push(&wk, arr, make_strings(&wk, 3));
+
+	double dump_secs, load_secs;
+	long size;
+	if (!round_trip(&wk, nested, &res, &dump_secs, &load_secs, &size)) {
+		goto ret;
+	} else if (!obj_equal(&wk, nested, res)) {
+		fprintf(stderr, "loaded object differs from the original\n");
+		goto ret;
+	}
+
+	ret = true;
+ret:
+	workspace_destroy_bare(&wk);
+	return ret;
+}
+
+static bool
+bench(uint32_t n)
+{
+	bool ret = false;
+	struct workspace wk = { 0 };
+	workspace_init_bare(&wk);
+
+	obj arr = make_strings(&wk, n), res;
+	double dump_secs, load_secs;
+	long size;
+
+	if (!round_trip(&wk, arr, &res, &dump_secs, &load_secs, &size)) {
+		goto ret;
+	}
+
+	printf("%10u strings %10ld bytes  dump %8.3fs  load %8.3fs\n", n, size, dump_secs, load_secs);
+
+	ret = true;
+ret:
+	workspace_destroy_bare(&wk);
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t n;
+
+	platform_init();
+	log_init();
+
+	switch (bench_parse_args(argc, argv, "strings", 1000, UINT32_MAX, &n)) {
+	case bench_mode_invalid: return 1;
+	case bench_mode_check: return check() ? 0 : 1;
+	case bench_mode_run: break;
+	}
+
+	return bench(n) ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+/*
+ * Correctness check and throughput benchmark for sha_256.c.
+ *
+ * usage: sha_256 check
+ *        sha_256 <bytes>[k|m|g]
+ *
+ * check compares the hardware implementation, if any, with the scalar one.
+ * Otherwise the given amount of input is hashed with each implementation,
+ * either as a single buffer or streamed in 1m pieces if it is larger than
+ * that.
+ */
+
+#include "compat.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "bench.h"
+#include "sha_256.h"
+
+#define STREAM_BUF_SIZE (1024 * 1024)
+
+static void
+fill(uint8_t *buf, size_t len)
+{
+	size_t i;
+	uint32_t x = 0x12345678;
+
+	for (i = 0; i < len; ++i) {
+		x = x * 1103515245 + 12345;
+		buf[i] = x >> 24;
+	}
+}
+
+static void
+hash_split(uint8_t hash[32], const uint8_t *buf, size_t len, size_t step)
+{
+	size_t n;
+	struct sha_256 sha;
+
+	sha_256_init(&sha);
+	for (; len; len -= n, buf += n) {
+		n = len < step ? len : step;
+		sha_256_write(&sha, buf, n);
+	}
+	sha_256_close(&sha, hash);
+}
+
+static bool
+check(void)
+{
+	static const uint8_t abc_hash[32] = {
+		0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+		0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+	};
+	const size_t max = 4096;
+	uint8_t *buf = malloc(max), (*expect)[32] = malloc((max + 1) * 32), hash[32];
+	size_t len;
+	bool ok = true;
+
+	printf("checking %s against scalar\n", sha_256_impl_name());
+
+	fill(buf, max);
+
+	calc_sha_256(hash, "abc", 3);
+	if (memcmp(hash, abc_hash, 32) != 0) {
+		printf("wrong hash for 'abc'\n");
+		ok = false;
+	}
+
+	for (len = 0; len <= max; ++len) {
+		calc_sha_256(expect[len], buf, len);
+	}
+
+	sha_256_force_scalar();
+
+	for (len = 0; len <= max; ++len) {
+		hash_split(hash, buf, len, (len % 67) + 1);
+		if (memcmp(hash, expect[len], 32) != 0) {
+			printf("hash mismatch for %zu bytes\n", len);
+			ok = false;
+		}
+	}
+
+	free(expect);
+	free(buf);
+	return ok;
+}
+
+static void
+bench(size_t len)
+{
+	uint8_t hash[32];
+	size_t buf_len = len < STREAM_BUF_SIZE ? len : STREAM_BUF_SIZE;
+	uint8_t *buf = malloc(buf_len);
+	/* repeat small inputs so that each measurement hashes at least 256m */
+	size_t i, reps = len < 256u * 1024 * 1024 ? (256u * 1024 * 1024) / len : 1;
+	uint32_t pass;
+
+	fill(buf, buf_len);
+
+	for (pass = 0; pass < 2; ++pass) {
+		if (pass) {
+			sha_256_force_scalar();
+		}
+
+		clock_t start = clock();
+
+		for (i = 0; i < reps; ++i) {
+			if (len == buf_len) {
+				calc_sha_256(hash, buf, len);
+			} else {
+				size_t n, rem;
+				struct sha_256 sha;
+
+				sha_256_init(&sha);
+				for (rem = len; rem; rem -= n) {
+					n = rem < buf_len ? rem : buf_len;
+					sha_256_write(&sha, buf, n);
+				}
+				sha_256_close(&sha, hash);
+			}
+		}
+
+		double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+		double mb = (double)len * reps / (1024.0 * 1024.0);
+
+		printf("%-8s %12zu bytes x %-8zu %8.3fs %10.1f MiB/s\n",
+			sha_256_impl_name(), len, reps, secs, secs > 0 ? mb / secs : 0);
+	}
+
+	free(buf);
+}
+
+int
+main(int argc, char *argv[])
+{
+	uint64_t len;
+
+	switch (bench_parse_args(argc, argv, "bytes", 1024, SIZE_MAX, &len)) {
+	case bench_mode_invalid: return 1;
+	case bench_mode_check: return check() ? 0 : 1;
+	case bench_mode_run: break;
+	}
+
+	bench(len);
+	return 0;
+}
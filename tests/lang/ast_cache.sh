@@ -0,0 +1,51 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+# Check that setup -r saves the ast of meson.build to the private dir and
+# that a later setup loads it, and that a truncated or stale file is
+# ignored and the source is parsed again.
+
+set -eux
+
+muon="$1"
+dir="$2"
+
+rm -rf "$dir"
+mkdir -p "$dir"
+cd "$dir"
+
+# Runs setup -r, forcing a reconfigure, and checks the number of asts
+# loaded from and saved to the cache, and the message printed.
+setup() {
+	rm -f build/muon-private/regenerate_deps.dat
+	"$muon" -v setup -r build > log.txt 2>&1 || { cat log.txt; exit 1; }
+	cat log.txt
+	grep -q "ast cache: [0-9]* hits, $1 loaded, $2 saved" log.txt
+	grep -q "message: $3" log.txt
+}
+
+cat > meson.build <<MESON
+project('ast_cache')
+message('one')
+MESON
+
+"$muon" setup build
+test ! -d build/muon-private/ast_cache
+
+setup 0 1 one
+setup 1 0 one
+
+cache="$(ls build/muon-private/ast_cache/*.dat)"
+head -c 100 "$cache" > truncated
+mv truncated "$cache"
+setup 0 1 one
+setup 1 0 one
+
+cat > meson.build <<MESON
+project('ast_cache')
+message('two')
+MESON
+
+setup 0 1 two
+setup 1 0 two
@@ -0,0 +1,37 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* usage: check <file> <expected contents> */
+int
+main(int argc, char *argv[])
+{
+	char buf[1024];
+	size_t len;
+	FILE *f;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <file> <expected contents>\n", argv[0]);
+		return 1;
+	}
+
+	if (!(f = fopen(argv[1], "r"))) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	len = fread(buf, 1, sizeof(buf) - 1, f);
+	buf[len] = 0;
+	fclose(f);
+
+	if (strcmp(buf, argv[2]) != 0) {
+		fprintf(stderr, "%s: expected '%s', got '%s'\n", argv[1], argv[2], buf);
+		return 1;
+	}
+
+	return 0;
+}
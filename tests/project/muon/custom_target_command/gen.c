@@ -0,0 +1,50 @@
+/*
+ * SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+ * SPDX-License-Identifier: GPL-3.0-only
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * usage: gen <output> <item>...
+ *
+ * Writes each item to output, separated by ';'.  An item is either the name
+ * of an environment variable, '=' followed by a literal string, or '-' for
+ * the contents of stdin.
+ */
+int
+main(int argc, char *argv[])
+{
+	FILE *out;
+	int i, c;
+
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s <output> <item>...\n", argv[0]);
+		return 1;
+	}
+
+	if (!(out = fopen(argv[1], "w"))) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	for (i = 2; i < argc; ++i) {
+		if (i > 2) {
+			fputc(';', out);
+		}
+
+		if (argv[i][0] == '=') {
+			fputs(&argv[i][1], out);
+		} else if (argv[i][0] == '-' && !argv[i][1]) {
+			while ((c = getchar()) != EOF) {
+				fputc(c, out);
+			}
+		} else {
+			const char *v = getenv(argv[i]);
+			fputs(v ? v : "(unset)", out);
+		}
+	}
+
+	return fclose(out) != 0;
+}
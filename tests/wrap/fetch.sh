@@ -0,0 +1,66 @@
+#!/bin/sh
+# SPDX-FileCopyrightText: Stone Tickle <lattis@mochiro.moe>
+# SPDX-License-Identifier: GPL-3.0-only
+
+# Fetch one file:// wrap with a matching source_hash and one without, and
+# check that only the verified archive ends up in packagecache and that the
+# bad archive is downloaded only once.
+
+set -eux
+
+muon="$1"
+dir="$2"
+have_libarchive="$3"
+
+sha256() {
+	if command -v sha256sum >/dev/null; then
+		sha256sum "$1" | cut -d ' ' -f 1
+	else
+		shasum -a 256 "$1" | cut -d ' ' -f 1
+	fi
+}
+
+rm -rf "$dir"
+mkdir -p "$dir/src/good" "$dir/src/bad" "$dir/subprojects"
+cd "$dir"
+
+echo "project('good')" > src/good/meson.build
+echo "project('bad')" > src/bad/meson.build
+tar -C src -cf good.tar good
+tar -C src -cf bad.tar bad
+
+cat > subprojects/good.wrap <<WRAP
+[wrap-file]
+directory = good
+source_url = file://$dir/good.tar
+source_filename = good.tar
+source_hash = $(sha256 good.tar)
+WRAP
+
+cat > subprojects/bad.wrap <<WRAP
+[wrap-file]
+directory = bad
+source_url = file://$dir/bad.tar
+source_filename = bad.tar
+source_hash = $(sha256 good.tar)
+WRAP
+
+"$muon" subprojects download > log.txt 2>&1
+cat log.txt
+
+if [ "$(grep -c "fetching 'file://$dir/bad.tar'" log.txt)" != 1 ]; then
+	exit 1
+fi
+
+cmp good.tar subprojects/packagecache/good.tar
+
+if [ "$(ls subprojects/packagecache)" != "good.tar" ]; then
+	ls -a subprojects/packagecache
+	exit 1
+fi
+
+if [ "$have_libarchive" = true ]; then
+	test -f subprojects/good/meson.build
+fi
+
+test ! -e subprojects/bad